@@ -0,0 +1,778 @@
+//benchmark runner, src/main.c built against the pebble.h stand-in with a simulated phone on the other end of the radio
+//every scenario runs in a forked child so it starts from the app's initial state
+
+#include "host.h"
+#define TRACE_CLOCK_US() host_trace_us() //update procs take no virtual time, the trace gets their wall time
+#define main watch_main
+#include "../src/main.c"
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include "host.h"
+#include "phone.c" //uses the app's keys and packbits, so it is built into this unit too
+
+static const char* trace_path = "trace.json";
+
+static uint64_t wall_ns(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000u + time.tv_nsec;
+}
+
+//runs body repeatedly for about 50ms of wall time, returns ns per run
+//the barrier keeps the compiler from merging runs of an inlined body
+#define TIME_NS(body) ({ \
+	uint64_t runs_ = 0, started_ = wall_ns(), elapsed_; \
+	do { body; __asm__ volatile("" ::: "memory"); runs_++; elapsed_ = wall_ns() - started_; } while(elapsed_ < 50000000u || runs_ < 10); \
+	(double)elapsed_ / runs_; })
+
+static pid_t fork_child(void) //anything still buffered would be printed again by the child
+{
+	fflush(stdout);
+	return fork();
+}
+
+static void boot_watch(void) //init() alone, main() would deinit() as soon as the stand-in event loop returns
+{
+	host_reset_counters();
+	init();
+	host_render();
+}
+
+static char card_complete(int card)
+{
+	int slot = find_slot(card);
+	return slot >= 0 && slot_loaded[slot] == ALL_LOADED;
+}
+
+static char cards_complete(int first, int last)
+{
+	for(int card = first; card <= last; card++)
+	{
+		if(!card_complete(card))
+			return 0;
+	}
+	return 1;
+}
+
+//runs until the first `last` cards are complete or limit ms pass, returns the time taken or -1
+static int32_t load_cards(int last, uint32_t limit)
+{
+	uint32_t started = host_now();
+	while(!cards_complete(0, last))
+	{
+		if(host_now() - started > limit)
+			return -1;
+		host_run_for(5);
+	}
+	return host_now() - started;
+}
+
+static void hide_watchface_now(void)
+{
+	host_click(BUTTON_ID_DOWN);
+	host_run_for(ANIMATION_DURATION + 100);
+}
+
+//memory: every fixed buffer the app keeps
+static void run_memory(void)
+{
+	size_t images = sizeof(back_image_data) + sizeof(icon_image_data);
+	size_t total = images + sizeof(arena) + sizeof(icon_store_data) + sizeof(strings);
+
+	printf("  %-34s %6zu B\n", "working bitmaps", images);
+	printf("  %-34s %6zu B\n", "packed arena", sizeof(arena));
+	printf("  %-34s %6s\n", "staging buffer", "in the working bitmaps");
+	printf("  %-34s %6zu B\n", "icon store", sizeof(icon_store_data));
+	printf("  %-34s %6zu B\n", "string arena", sizeof(strings));
+	printf("  %-34s %6zu B  (baseline 13496 B)\n", "image and string buffers", total);
+	printf("  %-34s %6zu B\n", "transfer table", sizeof(transfers));
+	printf("  %-34s %6zu B\n", "outbox evictions and icon statuses", sizeof(evicted_cards) + sizeof(icon_status_hashes));
+	total += sizeof(transfers) + sizeof(evicted_cards) + sizeof(icon_status_hashes);
+	printf("  %-34s %6zu B  (%+d B)\n", "all of the above", total, (int)total - 13496);
+
+	//the baseline held 4 cards, what the same buffers hold with the corpus images and icons
+	static uint8_t image_data[IMAGE_SIZE] __attribute__((aligned(4)));
+	static uint8_t icon_data[ICON_SIZE] __attribute__((aligned(4)));
+	phone_setup(PHONE_DEFAULT);
+	GBitmap image = {.addr = image_data, .bounds = GRect(0,0,144,144), .row_size_bytes = ROW_SIZE};
+	GBitmap icon = {.addr = icon_data, .bounds = GRect(0,0,48,48), .row_size_bytes = ICON_ROW_SIZE};
+	int packed = 0;
+	for(int i = 0; i < corpus_count; i++)
+	{
+		bitmap_clear(&image);
+		bitmap_copy_rows(&image, 0, corpus[i].rows[0], 144 * 18);
+		packed += pack_rows(NULL, &image) * ICON_KINDS;
+	}
+	for(int kind = 0; kind < ICON_KINDS; kind++)
+	{
+		bitmap_clear(&icon);
+		bitmap_copy_rows(&icon, 0, icons[kind][0], 48 * ICON_ROW_BYTES);
+		packed += pack_rows(NULL, &icon) * corpus_count;
+	}
+	packed /= corpus_count * ICON_KINDS;
+	printf("  %-34s %6d B\n", "packed card, corpus average", packed);
+	printf("  %-34s %6.1f  (%d decoded, %.1f packed, text for %d)\n", "cards with images held", WORKING_SIZE + (double)ARENA_SIZE / packed, WORKING_SIZE, (double)ARENA_SIZE / packed, CACHE_SIZE);
+
+	boot_watch();
+	load_cards(2, 60000);
+	printf("  %-34s %6zu B  (inbox %u B)\n", "heap high water after 3 cards", host_heap_high_water(), (unsigned)inbox_size);
+	printf("  %-34s %6zu B\n", "  as sample_heap saw it", heap_high_water);
+}
+
+//calls: the hot functions one at a time
+static uint8_t call_buffer[4096];
+
+static void call_handler(const uint8_t* message, uint16_t size)
+{
+	DictionaryIterator iter;
+	memcpy(call_buffer, message, size);
+	dict_read_begin_from_buffer(&iter, call_buffer, size);
+	in_received_handler(&iter, NULL);
+}
+
+static void run_calls(void)
+{
+	phone_setup(PHONE_DEFAULT);
+	boot_watch();
+	load_cards(2, 60000);
+	hide_watchface_now();
+	phone.paused = 1;
+
+	uint8_t text[1024], rle_chunk[4096], raw_chunk[4096];
+	uint16_t text_size = phone_text_message(text, 0);
+	uint16_t rle_size = phone_last_chunk_message(rle_chunk, 0, UPDATEIMAGE_RLE);
+	uint16_t raw_size = phone_last_chunk_message(raw_chunk, 0, UPDATEIMAGE);
+
+	printf("  %-40s %9.2f us\n", "in_received_handler UPDATETEXT", TIME_NS(call_handler(text, text_size)) / 1000);
+	printf("  %-40s %9.2f us\n", "in_received_handler UPDATEIMAGE_RLE", TIME_NS(call_handler(rle_chunk, rle_size)) / 1000);
+	printf("  %-40s %9.2f us\n", "in_received_handler UPDATEIMAGE", TIME_NS(call_handler(raw_chunk, raw_size)) / 1000);
+	printf("  %-40s %9.2f us\n", "update_card", TIME_NS(update_card(host_context(), current)) / 1000);
+	printf("  %-40s %9.2f us\n", "update_back", TIME_NS(update_back(host_context(), current)) / 1000);
+	printf("  %-40s %9.2f us\n", "resize_layers", TIME_NS(resize_layers()) / 1000);
+	printf("  %-40s %9.2f us\n", "full-screen redraw", TIME_NS(host_render_all()) / 1000);
+}
+
+//kernels: bitmap_ops against the byte and bit loops they replaced, output compared byte for byte
+static uint8_t reference_image[IMAGE_SIZE] __attribute__((aligned(4)));
+static uint8_t kernel_image[IMAGE_SIZE] __attribute__((aligned(4)));
+static uint8_t baseline_icon[ICON_SIZE] __attribute__((aligned(4)));
+static uint8_t kernel_icon[ICON_SIZE] __attribute__((aligned(4)));
+
+static __attribute__((noinline)) void reference_blank_image(void) //checkerboard a bit at a time
+{
+	for(int row = 0; row < 144; row++)
+	{
+		for(int col = 0; col < ROW_SIZE; col++)
+		{
+			uint8_t* current_byte = &reference_image[row * ROW_SIZE + col];
+			*current_byte = 0;
+			for(int bit = 0; bit < 8; bit++)
+			{
+				*current_byte += ((row % 2) + (col * 8 + bit)) % 2;
+				if(bit != 7)
+					*current_byte <<= 1;
+			}
+		}
+	}
+}
+
+static __attribute__((noinline)) void reference_blank_icon(void)
+{
+	for(int row = 0; row < 48; row++)
+	{
+		for(int col = 0; col < ICON_ROW_SIZE; col++)
+			baseline_icon[row * ICON_ROW_SIZE + col] = 0;
+	}
+}
+
+static __attribute__((noinline)) void reference_copy_rows(int starting_row, const uint8_t* src, int rows)
+{
+	for(int additional_rows = 0; additional_rows < rows; additional_rows++)
+	{
+		for(int i = 0; i < 18; i++)
+			reference_image[i + (160/8)*(starting_row+additional_rows)] = src[i+(144/8)*additional_rows];
+	}
+}
+
+static __attribute__((noinline)) void reference_invert(void)
+{
+	for(int i = 0; i < IMAGE_SIZE; i++)
+		reference_image[i] = ~reference_image[i];
+}
+
+static void kernel_line(const char* name, double reference_ns, double kernel_ns, char identical)
+{
+	printf("  %-22s %9.2f us %9.2f us %6.1fx   %s\n", name, reference_ns / 1000, kernel_ns / 1000, reference_ns / kernel_ns, (identical)? "identical" : "DIFFERENT");
+}
+
+static void run_kernels(void)
+{
+	GBitmap image = {.addr = kernel_image, .bounds = GRect(0,0,144,144), .row_size_bytes = ROW_SIZE};
+	GBitmap icon = {.addr = kernel_icon, .bounds = GRect(0,0,48,48), .row_size_bytes = ICON_ROW_SIZE};
+	const uint8_t* rows = &corpus[0].rows[0][0];
+
+	printf("  host cpu built without vectorizing, compare the ratios rather than the times\n");
+	printf("  %-22s %12s %12s %7s\n", "kernel", "reference", "bitmap_ops", "speedup");
+
+	double reference_ns = TIME_NS(reference_blank_image());
+	double kernel_ns = TIME_NS(bitmap_fill_pattern(&image, 0x55555555, 0xAAAAAAAA));
+	kernel_line("checkerboard", reference_ns, kernel_ns, memcmp(reference_image, kernel_image, IMAGE_SIZE) == 0);
+
+	memset(kernel_icon, 0xFF, ICON_SIZE);
+	reference_ns = TIME_NS(reference_blank_icon());
+	kernel_ns = TIME_NS(bitmap_clear(&icon));
+	kernel_line("clear icon", reference_ns, kernel_ns, memcmp(baseline_icon, kernel_icon, ICON_SIZE) == 0);
+
+	//four rows a message, the old IMAGE_MESSAGE_ROWS
+	reference_ns = TIME_NS(for(int row = 0; row < 144; row += 4) reference_copy_rows(row, rows + row * 18, 4));
+	kernel_ns = TIME_NS(for(int row = 0; row < 144; row += 4) bitmap_copy_rows(&image, row, rows + row * 18, 4 * 18));
+	char identical = 1;
+	for(int row = 0; row < 144; row++)
+		identical &= memcmp(&reference_image[row * ROW_SIZE], &kernel_image[row * ROW_SIZE], 18) == 0;
+	kernel_line("copy 144 rows", reference_ns, kernel_ns, identical);
+
+	//one pass each on the same rows for the comparison, then timed on their own
+	memcpy(kernel_image, reference_image, IMAGE_SIZE);
+	reference_invert();
+	bitmap_invert(&image);
+	identical = memcmp(reference_image, kernel_image, IMAGE_SIZE) == 0;
+	reference_ns = TIME_NS(reference_invert());
+	kernel_ns = TIME_NS(bitmap_invert(&image));
+	kernel_line("invert", reference_ns, kernel_ns, identical);
+}
+
+//compression: packbits against raw rows for every corpus image
+static void run_compression(void)
+{
+	phone_setup(PHONE_DEFAULT);
+	boot_watch();
+	host_run_for(100); //handshake
+
+	printf("  inbox %u B, watch advertises %d image rows and %d icon rows a message\n", (unsigned)inbox_size, image_message_rows, icon_message_rows);
+	int overflow = phone_chunk_overhead(1, 0) + image_message_rows * 18 - (int)inbox_size;
+	printf("  raw chunk at the advertised rows with TRANSFER and SEQUENCE: %d B %s the inbox\n", image_message_rows * 18 + phone_chunk_overhead(1, 0), (overflow > 0)? "overflows" : "fits");
+	overflow = phone_chunk_overhead(1, 1) + image_message_rows * 18 - (int)inbox_size;
+	printf("  raw interlaced chunk with TRANSFER, SEQUENCE and PASS:     %d B %s the inbox\n\n", image_message_rows * 18 + phone_chunk_overhead(1, 1), (overflow > 0)? "overflows" : "fits");
+
+	printf("  %-22s %8s %8s %7s %10s %10s\n", "image", "raw B", "rle B", "ratio", "raw msgs", "rle msgs");
+	int raw_total = 0, packed_total = 0, raw_messages = 0, packed_messages = 0;
+	for(int i = 0; i < corpus_count; i++)
+	{
+		int packed = 0;
+		uint8_t row_packed[64];
+		for(int row = 0; row < 144; row++)
+			packed += pack_row(row_packed, corpus[i].rows[row], 18);
+		int raw_count = (144 + image_message_rows - 1) / image_message_rows;
+		int packed_count = phone_rle_messages(corpus[i].rows[0], 144, 18, 1);
+
+		printf("  %-22s %8d %8d %6.2fx %10d %10d\n", corpus[i].name, 144 * 18, packed, 144.0 * 18 / packed, raw_count, packed_count);
+		raw_total += 144 * 18;
+		packed_total += packed;
+		raw_messages += raw_count;
+		packed_messages += packed_count;
+	}
+	printf("  %-22s %8d %8d %6.2fx %10d %10d\n", "all", raw_total, packed_total, (double)raw_total / packed_total, raw_messages, packed_messages);
+	printf("  (36 raw messages an image before the inbox was sized from app_message_inbox_size_maximum)\n");
+}
+
+//decode: packing a card into the arena and decoding it back for drawing
+static void run_decode(void)
+{
+	static uint8_t packed[IMAGE_SIZE * 2];
+	GBitmap image = {.addr = kernel_image, .bounds = GRect(0,0,144,144), .row_size_bytes = ROW_SIZE};
+
+	printf("  %-22s %8s %10s %10s\n", "image", "packed B", "pack", "decode");
+	for(int i = 0; i < corpus_count; i++)
+	{
+		bitmap_clear(&image);
+		bitmap_copy_rows(&image, 0, corpus[i].rows[0], 144 * 18);
+		int length = pack_rows(packed, &image);
+		double pack_ns = TIME_NS(pack_rows(packed, &image));
+		double decode_ns = TIME_NS(unpack_rows(kernel_image, ROW_SIZE, 18, 144, 0, packed, length));
+		printf("  %-22s %8d %8.1f us %8.1f us\n", corpus[i].name, length, pack_ns / 1000, decode_ns / 1000);
+	}
+
+	//a card brought back into a working bitmap, the pair swapped over and over
+	phone_setup(PHONE_DEFAULT);
+	boot_watch();
+	load_cards(3, 60000);
+	hide_watchface_now();
+	phone.paused = 1;
+	int slot_a = find_slot(2);
+	int slot_b = find_slot(3);
+	int flip = 0;
+	double swap_ns = TIME_NS(acquire_working((flip ^= 1)? slot_a : slot_b, TAKE_ANY));
+	printf("  acquire_working of a packed card: %.1f us\n", swap_ns / 1000);
+}
+
+//transition: one swipe between loaded cards
+static void run_transition(void)
+{
+	phone_setup(PHONE_DEFAULT);
+	boot_watch();
+	load_cards(2, 60000);
+	hide_watchface_now();
+	phone.paused = 1;
+
+	host_reset_counters();
+	host_click(BUTTON_ID_DOWN);
+	host_run_for(ANIMATION_DURATION + 200);
+
+	printf("  animation updates        %u\n", host_counters.animation_updates);
+	printf("  layer frames moved       %u\n", host_counters.frame_sets);
+	printf("  layer_mark_dirty calls   %u\n", host_counters.dirty_marks);
+	printf("  window redraws           %u\n", host_counters.renders);
+	printf("  update proc calls        %u\n", host_counters.update_procs);
+	printf("  text layouts measured    %u\n", host_counters.text_layouts);
+	printf("  texts drawn              %u\n", host_counters.texts_drawn);
+	printf("  frame time (host)        %.1f us\n", (host_counters.renders)? host_counters.render_ns / 1000.0 / host_counters.renders : 0);
+}
+
+//navigation: reading each card for a while, how often the next one is already complete
+static void run_navigation(void)
+{
+	static const uint32_t read_times[] = { 500, 1500, 3000, 6000 };
+
+	printf("  %-10s %8s %8s\n", "read ms", "landed", "of");
+	for(unsigned i = 0; i < sizeof(read_times) / sizeof(read_times[0]); i++)
+	{
+		pid_t pid = fork_child();
+		if(pid == 0)
+		{
+			phone_setup(PHONE_DEFAULT);
+			phone.total = 20;
+			boot_watch();
+			load_cards(0, 60000);
+			hide_watchface_now();
+
+			int landed = 0;
+			for(int press = 0; press < phone.total - 1; press++)
+			{
+				host_run_for(read_times[i]);
+				host_click(BUTTON_ID_DOWN);
+				landed += card_complete(current);
+			}
+			printf("  %-10u %8d %8d\n", read_times[i], landed, phone.total - 1);
+			fflush(stdout);
+			_exit(0);
+		}
+		waitpid(pid, NULL, 0);
+	}
+}
+
+//lossy: loading the first cards while the link loses messages, averaged over a few drop patterns
+#define LOSSY_SEEDS 8
+
+typedef struct {
+	int32_t first; //card 0 complete, -1 never
+	int32_t all; //cards 0-2 complete
+	uint32_t messages;
+	uint32_t lost;
+	uint32_t overflow;
+} LossyResult;
+
+static void lossy_line(const char* name, PhoneOptions options, int drop, int failures) //failures: first watch sends that fail
+{
+	LossyResult* results = mmap(NULL, sizeof(LossyResult) * LOSSY_SEEDS, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	for(int seed = 0; seed < LOSSY_SEEDS; seed++)
+	{
+		pid_t pid = fork_child();
+		if(pid == 0)
+		{
+			LossyResult* result = &results[seed];
+			options.drop_percent = drop;
+			phone_setup(options);
+			random_state = 2463534242u + seed * 7919;
+			host_fail_outbox(failures);
+			boot_watch();
+			result->first = load_cards(0, 60000);
+			result->all = (result->first >= 0)? load_cards(2, 60000 - result->first) : -1;
+			if(result->all >= 0)
+				result->all += result->first;
+			result->messages = phone.messages;
+			result->lost = phone.lost;
+			result->overflow = host_counters.messages_dropped;
+			_exit(0);
+		}
+		waitpid(pid, NULL, 0);
+	}
+
+	//means over the runs that completed, with how many did
+	double first = 0, all = 0, messages = 0, lost = 0, overflow = 0;
+	int first_done = 0, all_done = 0;
+	for(int seed = 0; seed < LOSSY_SEEDS; seed++)
+	{
+		if(results[seed].first >= 0)
+			first += results[seed].first, first_done++;
+		if(results[seed].all >= 0)
+			all += results[seed].all, all_done++;
+		messages += results[seed].messages;
+		lost += results[seed].lost;
+		overflow += results[seed].overflow;
+	}
+	char first_text[24], all_text[24];
+	snprintf(first_text, sizeof(first_text), (first_done)? "%.0f ms %d/%d" : "never", first / (first_done? first_done : 1), first_done, LOSSY_SEEDS);
+	snprintf(all_text, sizeof(all_text), (all_done)? "%.0f ms %d/%d" : "never", all / (all_done? all_done : 1), all_done, LOSSY_SEEDS);
+	printf("  %-18s %4d%% %14s %14s %8.1f %8.1f %8.1f\n", name, drop, first_text, all_text, messages / LOSSY_SEEDS, lost / LOSSY_SEEDS, overflow / LOSSY_SEEDS);
+	munmap(results, sizeof(LossyResult) * LOSSY_SEEDS);
+}
+
+static void run_lossy(void)
+{
+	static const int drops[] = { 0, 5, 10, 20 };
+	PhoneOptions untracked = PHONE_DEFAULT;
+	untracked.tracked = 0;
+	PhoneOptions raw = PHONE_DEFAULT;
+	raw.rle = 0;
+
+	printf("  mean of %d drop patterns, runs that completed out of %d\n", LOSSY_SEEDS, LOSSY_SEEDS);
+	printf("  %-18s %5s %14s %14s %8s %8s %8s\n", "mode", "drop", "card 0", "cards 0-2", "sent", "lost", "overflow");
+	for(unsigned i = 0; i < sizeof(drops) / sizeof(drops[0]); i++)
+		lossy_line("rle, tracked", PHONE_DEFAULT, drops[i], 0);
+	for(unsigned i = 0; i < sizeof(drops) / sizeof(drops[0]); i++)
+		lossy_line("rle, untracked", untracked, drops[i], 0);
+	lossy_line("raw, tracked", raw, 0, 0);
+	lossy_line("3 watch sends fail", PHONE_DEFAULT, 0, 3);
+}
+
+//startup: time from launch to the first complete card on screen, with and without a saved cache
+
+static void startup_line(const char* name, PhoneOptions options, FILE* saved)
+{
+	pid_t pid = fork_child();
+	if(pid == 0)
+	{
+		host_persist_clear();
+		if(saved)
+		{
+			rewind(saved);
+			host_persist_load(saved);
+		}
+		phone_setup(options);
+		boot_watch();
+		uint32_t messages = phone.messages;
+		int32_t time = load_cards(0, 60000);
+		printf("  %-28s %8d ms, %u messages before it\n", name, time, phone.messages - messages);
+		fflush(stdout);
+		_exit(0);
+	}
+	waitpid(pid, NULL, 0);
+}
+
+static void startup_session(PhoneOptions options, FILE* saved) //loads the first cards and leaves them in persist storage
+{
+	pid_t pid = fork_child();
+	if(pid == 0)
+	{
+		host_persist_clear();
+		phone_setup(options);
+		boot_watch();
+		load_cards(2, 60000);
+		int count = 0;
+		for(int i = 0; i < PERSIST_RECORDS; i++)
+			count += persist_cards[i] >= 0;
+		printf("  %d of the first 3 cards saved\n", count);
+		fflush(stdout);
+		deinit();
+		host_persist_save(saved);
+		fflush(saved);
+		_exit(0);
+	}
+	waitpid(pid, NULL, 0);
+}
+
+static void run_startup(void)
+{
+	PhoneOptions shared = PHONE_DEFAULT;
+	shared.iconref = 1;
+
+	FILE* saved = tmpfile();
+	startup_session(PHONE_DEFAULT, saved);
+	startup_line("cold", PHONE_DEFAULT, NULL);
+	startup_line("saved cache", PHONE_DEFAULT, saved);
+	fclose(saved);
+
+	saved = tmpfile();
+	startup_session(shared, saved);
+	startup_line("cold, shared icons", shared, NULL);
+	startup_line("saved cache, shared icons", shared, saved);
+	fclose(saved);
+}
+
+//interlace: how soon the visible background looks like the real one
+static int matching_permille(int card) //share of background pixels already right, as drawn
+{
+	int slot = find_slot(card);
+	int working = (slot >= 0)? working_for(slot) : -1;
+	if(working < 0)
+		return 0;
+
+	const uint8_t* drawn = back_image_data[working];
+	const CorpusImage* target = &corpus[phone_card_image(card)];
+	int matching = 0;
+	for(int row = 0; row < 144; row++)
+	{
+		for(int col = 0; col < 18; col++)
+			matching += 8 - __builtin_popcount(drawn[row * ROW_SIZE + col] ^ target->rows[row][col]);
+	}
+	return matching * 1000 / (144 * 144);
+}
+
+static uint32_t back_redraws(void) //counted by the app's stats, always 0 in a STATS 0 build
+{
+#if STATS
+	return stats.redraws[BACK_LAYER_A] + stats.redraws[BACK_LAYER_B];
+#else
+	return 0;
+#endif
+}
+
+static void interlace_line(const char* name, PhoneOptions options)
+{
+	pid_t pid = fork_child();
+	if(pid == 0)
+	{
+		static const int thresholds[] = { 800, 900, 1000 };
+		int32_t reached[3] = { -1, -1, -1 };
+
+		phone_setup(options);
+		boot_watch();
+		hide_watchface_now();
+		while(!phone.image_started_at && host_now() < 60000)
+			host_run_for(1);
+
+		uint32_t renders = host_counters.renders;
+		uint32_t back_draws = back_redraws();
+		while(reached[2] < 0 && host_now() - phone.image_started_at < 60000)
+		{
+			host_run_for(1);
+			int permille = matching_permille(0);
+			for(int i = 0; i < 3; i++)
+			{
+				if(reached[i] < 0 && permille >= thresholds[i])
+					reached[i] = host_now() - phone.image_started_at;
+			}
+		}
+		printf("  %-14s %8d ms %8d ms %8d ms %8u %8u\n", name, reached[0], reached[1], reached[2], host_counters.renders - renders,
+			back_redraws() - back_draws);
+		fflush(stdout);
+		_exit(0);
+	}
+	waitpid(pid, NULL, 0);
+}
+
+static void run_interlace(void)
+{
+	PhoneOptions sequential = PHONE_DEFAULT;
+	sequential.rle = 0;
+	sequential.tracked = 0;
+	PhoneOptions interlaced = sequential;
+	interlaced.interlace = 1;
+
+	printf("  time from the first background chunk until that share of pixels is right on screen\n");
+	printf("  %-14s %11s %11s %11s %8s %8s\n", "mode", "80%", "90%", "100%", "redraws", "back");
+	interlace_line("sequential", sequential);
+	interlace_line("interlaced", interlaced);
+}
+
+//batch: the first cards one command a message against BATCH messages
+static void batch_line(const char* name, PhoneOptions options)
+{
+	pid_t pid = fork_child();
+	if(pid == 0)
+	{
+		phone_setup(options);
+		boot_watch();
+		int32_t time = load_cards(2, 60000);
+		printf("  %-22s %8d ms %8u msgs %8u B\n", name, time, phone.messages, phone.bytes);
+		fflush(stdout);
+		_exit(0);
+	}
+	waitpid(pid, NULL, 0);
+}
+
+static void run_batch(void)
+{
+	PhoneOptions batched = PHONE_DEFAULT;
+	batched.batch = 1;
+
+	printf("  cards 0-2 complete\n");
+	batch_line("one command a message", PHONE_DEFAULT);
+	batch_line("batched", batched);
+}
+
+//scroll: presses made faster than the transition, from the first press until the screen settles
+static void scroll_line(int presses)
+{
+	pid_t pid = fork_child();
+	if(pid == 0)
+	{
+		phone_setup(PHONE_DEFAULT);
+		phone.total = 24;
+		phone.text_only = 1;
+		boot_watch();
+		load_cards(0, 60000);
+		hide_watchface_now();
+		phone.paused = 1;
+
+		host_reset_counters();
+		uint32_t started = host_now();
+		int target = current + presses;
+		for(int press = 0; press < presses; press++)
+		{
+			host_click(BUTTON_ID_DOWN);
+			host_run_for(60);
+		}
+		while((current != target || animation_is_scheduled(transition) || !host_idle()) && host_now() - started < 20000)
+			host_run_for(1);
+
+		printf("  %4d presses %8u ms %8u redraws %8u update procs %8u animations\n", presses, host_now() - started, host_counters.renders, host_counters.update_procs, host_counters.animations_scheduled);
+		fflush(stdout);
+		_exit(0);
+	}
+	waitpid(pid, NULL, 0);
+}
+
+static void run_scroll(void)
+{
+	printf("  presses 60 ms apart\n");
+	scroll_line(1);
+	scroll_line(5);
+	scroll_line(20);
+}
+
+//trace: the frame trace of one swipe as a Chrome trace
+static void run_trace(void)
+{
+#if TRACE
+	static const char* names[] = { "back A", "back B", "card A", "card B", "expanded", "watchface", "", "animation tick", "message", "up", "down", "long down" };
+
+	phone_setup(PHONE_DEFAULT);
+	boot_watch();
+	load_cards(2, 60000);
+	hide_watchface_now();
+	phone.paused = 1;
+	trace_count = 0;
+	host_click(BUTTON_ID_DOWN);
+	host_run_for(ANIMATION_DURATION + 200);
+
+	FILE* file = fopen(trace_path, "w");
+	if(!file)
+	{
+		perror(trace_path);
+		return;
+	}
+	fprintf(file, "{\"traceEvents\":[\n");
+	for(int i = 0; i < trace_count; i++)
+	{
+		TraceEvent* event = &trace_events[(trace_head - trace_count + i + TRACE_SIZE) % TRACE_SIZE];
+		char instant = event->what > ANIMATION_TICK;
+		fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%u,\"pid\":1,\"tid\":1%s}\n", (i)? "," : "", names[event->what],
+			(instant)? "i" : (event->begin)? "B" : "E", event->time, (instant)? ",\"s\":\"g\"" : "");
+	}
+	fprintf(file, "]}\n");
+	fclose(file);
+	printf("  %d events written to %s\n", trace_count, trace_path);
+#else
+	printf("  built with TRACE 0, run bench-trace (make trace) for a Chrome trace\n");
+#endif
+}
+
+typedef struct {
+	const char* name;
+	const char* about;
+	void (*run)(void);
+} Scenario;
+
+static const Scenario scenarios[] = {
+	{ "memory", "fixed buffers and heap", run_memory },
+	{ "calls", "time per call of the hot functions", run_calls },
+	{ "kernels", "bitmap_ops against the loops they replaced", run_kernels },
+	{ "compression", "packbits ratio and messages per image", run_compression },
+	{ "decode", "packing and decoding cards", run_decode },
+	{ "transition", "layer updates and redraws in one swipe", run_transition },
+	{ "navigation", "swipes that land on a complete card", run_navigation },
+	{ "lossy", "load time over a lossy link", run_lossy },
+	{ "startup", "launch to first complete card", run_startup },
+	{ "interlace", "time to a recognizable background", run_interlace },
+	{ "batch", "one command a message against BATCH", run_batch },
+	{ "scroll", "input to settled for fast presses", run_scroll },
+	{ "trace", "Chrome trace of one swipe", run_trace },
+};
+
+#define SCENARIO_COUNT (int)(sizeof(scenarios) / sizeof(scenarios[0]))
+
+static void run_scenario(const Scenario* scenario)
+{
+	printf("%s: %s\n", scenario->name, scenario->about);
+	fflush(stdout);
+	pid_t pid = fork_child();
+	if(pid == 0)
+	{
+		scenario->run();
+		fflush(stdout);
+		_exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		printf("  FAILED (status %d)\n", status);
+	printf("\n");
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: bench [--inbox bytes] [--images file.pbm...] [--trace file.json] [--verbose] [scenario...]\n");
+	for(int i = 0; i < SCENARIO_COUNT; i++)
+		fprintf(stderr, "  %-12s %s\n", scenarios[i].name, scenarios[i].about);
+}
+
+int main(int argc, char** argv)
+{
+	const char* selected[SCENARIO_COUNT];
+	int selected_count = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--inbox") == 0 && i + 1 < argc)
+			host_set_inbox_maximum(atoi(argv[++i]));
+		else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			trace_path = argv[++i];
+		else if(strcmp(argv[i], "--verbose") == 0)
+			host_verbose = 1;
+		else if(strcmp(argv[i], "--images") == 0)
+		{
+			while(i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				if(!corpus_load_pbm(argv[++i]))
+					return 1;
+			}
+		}
+		else if(argv[i][0] == '-')
+		{
+			usage();
+			return 1;
+		}
+		else if(selected_count < SCENARIO_COUNT)
+			selected[selected_count++] = argv[i];
+	}
+	if(corpus_count == 0)
+		corpus_generate();
+
+	for(int i = 0; i < SCENARIO_COUNT; i++)
+	{
+		char wanted = (selected_count == 0);
+		for(int n = 0; n < selected_count; n++)
+			wanted |= strcmp(selected[n], scenarios[i].name) == 0;
+		if(wanted)
+			run_scenario(&scenarios[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "capture.h"
+
+static FILE* capture_file = NULL;
+
+static void write_record(uint8_t type, uint8_t button, const uint8_t* data, uint16_t length)
+{
+	uint32_t time = host_now();
+	fwrite(&time, 4, 1, capture_file);
+	fwrite(&type, 1, 1, capture_file);
+	fwrite(&button, 1, 1, capture_file);
+	fwrite(&length, 2, 1, capture_file);
+	if(length)
+		fwrite(data, length, 1, capture_file);
+}
+
+static void capture_message(const uint8_t* dictionary, uint16_t size, void* context)
+{
+	write_record(CAPTURE_MESSAGE, 0, dictionary, size);
+}
+
+static void capture_button(ButtonId button, char down, void* context)
+{
+	write_record((down)? CAPTURE_BUTTON_DOWN : CAPTURE_BUTTON_UP, button, NULL, 0);
+}
+
+char capture_start(const char* path)
+{
+	capture_file = fopen(path, "wb");
+	if(!capture_file)
+	{
+		perror(path);
+		return 0;
+	}
+
+	uint16_t version = CAPTURE_VERSION;
+	uint16_t inbox_maximum = host_inbox_maximum();
+	fwrite("PWPC", 4, 1, capture_file);
+	fwrite(&version, 2, 1, capture_file);
+	fwrite(&inbox_maximum, 2, 1, capture_file);
+
+	host_set_inbox_hook(capture_message, NULL);
+	host_set_button_hook(capture_button, NULL);
+	return 1;
+}
+
+void capture_finish(void)
+{
+	if(!capture_file)
+		return;
+
+	host_render();
+	uint32_t checksum = host_framebuffer_checksum();
+	write_record(CAPTURE_END, 0, (uint8_t*)&checksum, 4);
+	fclose(capture_file);
+	capture_file = NULL;
+	host_set_inbox_hook(NULL, NULL);
+	host_set_button_hook(NULL, NULL);
+}
+
+Capture* capture_load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	char magic[4];
+	uint16_t version, inbox_maximum;
+	if(!file || fread(magic, 4, 1, file) != 1 || memcmp(magic, "PWPC", 4) != 0 ||
+		fread(&version, 2, 1, file) != 1 || version != CAPTURE_VERSION || fread(&inbox_maximum, 2, 1, file) != 1)
+	{
+		fprintf(stderr, "%s: not a version %d capture\n", path, CAPTURE_VERSION);
+		if(file)
+			fclose(file);
+		return NULL;
+	}
+
+	Capture* capture = calloc(1, sizeof(Capture));
+	capture->inbox_maximum = inbox_maximum;
+	int allocated = 0;
+	CaptureRecord record;
+	while(fread(&record.time, 4, 1, file) == 1 && fread(&record.type, 1, 1, file) == 1 &&
+		fread(&record.button, 1, 1, file) == 1 && fread(&record.length, 2, 1, file) == 1)
+	{
+		record.data = malloc(record.length + 1);
+		if(record.length && fread(record.data, record.length, 1, file) != 1)
+		{
+			free(record.data);
+			break;
+		}
+		if(capture->count == allocated)
+		{
+			allocated = (allocated)? allocated * 2 : 256;
+			capture->records = realloc(capture->records, allocated * sizeof(CaptureRecord));
+		}
+		capture->records[capture->count++] = record;
+	}
+	fclose(file);
+	return capture;
+}
+
+void capture_free(Capture* capture)
+{
+	for(int i = 0; i < capture->count; i++)
+		free(capture->records[i].data);
+	free(capture->records);
+	free(capture);
+}
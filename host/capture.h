@@ -0,0 +1,38 @@
+#pragma once
+//session captures: every dictionary offered to the watch's inbox and every button press, with timestamps
+//file layout, little endian:
+//  header  "PWPC", uint16 version, uint16 inbox maximum
+//  record  uint32 virtual ms, uint8 type, uint8 button, uint16 length, then length bytes
+//a message record holds the whole dictionary as it came over the air, the end record holds the framebuffer checksum
+#include <stdint.h>
+
+#define CAPTURE_VERSION 1
+
+enum {
+	CAPTURE_MESSAGE,
+	CAPTURE_BUTTON_DOWN,
+	CAPTURE_BUTTON_UP,
+	CAPTURE_END
+};
+
+typedef struct {
+	uint32_t time;
+	uint8_t type;
+	uint8_t button;
+	uint16_t length;
+	uint8_t* data;
+} CaptureRecord;
+
+typedef struct {
+	uint32_t inbox_maximum;
+	int count;
+	CaptureRecord* records;
+} Capture;
+
+//recording, hooks the inbox and the buttons until capture_finish()
+char capture_start(const char* path);
+void capture_finish(void); //writes the end record with the current framebuffer checksum
+
+//reading a whole capture back, NULL when the file is not one
+Capture* capture_load(const char* path);
+void capture_free(Capture* capture);
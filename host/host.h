@@ -0,0 +1,82 @@
+#pragma once
+//driving the pebble.h stand-in from a runner: virtual clock, framebuffer, buttons and the radio
+#include <stdio.h>
+#include "pebble.h"
+
+#define HOST_SCREEN_W 144
+#define HOST_SCREEN_H 168
+#define HOST_ROW_SIZE 20 //framebuffer rows are padded to a word like the watch's
+#define HOST_FRAME_MS 33 //animation frame interval
+
+extern uint8_t host_framebuffer[HOST_SCREEN_H][HOST_ROW_SIZE];
+
+//counters, cleared with host_reset_counters()
+typedef struct {
+	uint32_t renders; //window redraws
+	uint32_t update_procs; //layer update proc calls
+	uint32_t frame_sets; //layer_set_frame calls that moved a layer
+	uint32_t dirty_marks; //layer_mark_dirty calls
+	uint32_t animation_updates; //animation update calls
+	uint32_t animations_scheduled;
+	uint32_t text_layouts; //graphics_text_layout_get_content_size calls
+	uint32_t texts_drawn;
+	uint32_t bitmaps_drawn;
+	uint32_t timers_fired;
+	uint32_t messages_in; //delivered to the inbox
+	uint32_t messages_dropped; //turned away by the inbox
+	uint32_t bytes_in;
+	uint32_t messages_out;
+	uint32_t bytes_out;
+	uint32_t outbox_failed;
+	uint32_t sniff_changes;
+	uint64_t render_ns; //wall time spent redrawing
+} HostCounters;
+
+extern HostCounters host_counters;
+void host_reset_counters(void);
+
+//clock, nothing happens between calls unless the runner asks for it
+uint32_t host_now(void);
+uint32_t host_trace_us(void); //host_now in us, plus the wall time spent since the clock last moved
+void host_run_until(uint32_t time); //fire timers, animation frames and scheduled events, redrawing after each
+void host_run_for(uint32_t ms);
+char host_idle(void); //no animation running and nothing dirty
+typedef void (*HostEvent)(void* data);
+void host_schedule(uint32_t time, HostEvent event, void* data);
+
+//drawing
+char host_render(void); //redraw the window if anything is dirty, returns 1 when it did
+void host_render_all(void); //redraw the whole window regardless
+GContext* host_context(void); //full screen context for calling update procs directly
+uint32_t host_framebuffer_checksum(void);
+void host_write_pbm(FILE* file);
+
+//buttons
+void host_button_down(ButtonId button);
+void host_button_up(ButtonId button);
+void host_click(ButtonId button); //press and release at the same instant
+typedef void (*HostButtonHook)(ButtonId button, char down, void* context);
+void host_set_button_hook(HostButtonHook hook, void* context); //sees every press and release
+
+//radio, messages from the phone and what the watch sends back
+AppMessageResult host_deliver(const uint8_t* dictionary, uint16_t size); //into the inbox now
+typedef void (*HostOutboxHook)(const uint8_t* dictionary, uint16_t size, void* context);
+void host_set_outbox_hook(HostOutboxHook hook, void* context);
+uint32_t host_inbox_maximum(void);
+void host_set_inbox_maximum(uint32_t size);
+void host_set_outbox_delay(uint32_t ms); //until sent or failed fires
+void host_fail_outbox(uint32_t count); //fail the next count sends with APP_MSG_SEND_TIMEOUT
+typedef void (*HostInboxHook)(const uint8_t* dictionary, uint16_t size, void* context);
+void host_set_inbox_hook(HostInboxHook hook, void* context); //sees every message offered to the inbox
+SniffInterval host_sniff_interval(void);
+
+//persist storage, kept across forked runs through a file
+void host_persist_clear(void);
+void host_persist_save(FILE* file);
+void host_persist_load(FILE* file);
+
+//heap, every shim allocation is counted against HOST_HEAP_SIZE
+#define HOST_HEAP_SIZE 8192
+size_t host_heap_high_water(void);
+
+extern char host_verbose; //print APP_LOG output
@@ -0,0 +1,1267 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "host.h"
+
+//host implementation of the pebble.h stand-in
+//time is virtual: it only moves inside host_run_until(), so runs are repeatable
+
+uint8_t host_framebuffer[HOST_SCREEN_H][HOST_ROW_SIZE];
+HostCounters host_counters;
+char host_verbose = 0;
+
+static uint32_t now = 0;
+
+//heap
+static size_t heap_used = 0;
+static size_t heap_high_water = 0;
+
+typedef struct {
+	size_t size;
+	uint64_t align;
+} Allocation;
+
+static void* host_alloc(size_t size)
+{
+	Allocation* allocation = calloc(1, sizeof(Allocation) + size);
+	allocation->size = size;
+	heap_used += size;
+	if(heap_used > heap_high_water)
+		heap_high_water = heap_used;
+	return allocation + 1;
+}
+
+static void host_free(void* pointer)
+{
+	if(!pointer)
+		return;
+	Allocation* allocation = (Allocation*)pointer - 1;
+	heap_used -= allocation->size;
+	free(allocation);
+}
+
+size_t heap_bytes_used(void)
+{
+	return heap_used;
+}
+
+size_t heap_bytes_free(void)
+{
+	return HOST_HEAP_SIZE - heap_used;
+}
+
+size_t host_heap_high_water(void)
+{
+	return heap_high_water;
+}
+
+void host_reset_counters(void)
+{
+	memset(&host_counters, 0, sizeof(host_counters));
+}
+
+void app_log(uint8_t log_level, const char* src_filename, int src_line_number, const char* fmt, ...)
+{
+	if(!host_verbose)
+		return;
+
+	va_list args;
+	va_start(args, fmt);
+	fprintf(stderr, "[%6u] %s:%d ", now, src_filename, src_line_number);
+	vfprintf(stderr, fmt, args);
+	fprintf(stderr, "\n");
+	va_end(args);
+}
+
+void app_event_loop(void)
+{
+}
+
+//geometry
+bool grect_equal(const GRect* const rect_a, const GRect* const rect_b)
+{
+	return rect_a->origin.x == rect_b->origin.x && rect_a->origin.y == rect_b->origin.y &&
+		rect_a->size.w == rect_b->size.w && rect_a->size.h == rect_b->size.h;
+}
+
+static GRect intersect(GRect a, GRect b)
+{
+	int x0 = (a.origin.x > b.origin.x)? a.origin.x : b.origin.x;
+	int y0 = (a.origin.y > b.origin.y)? a.origin.y : b.origin.y;
+	int x1 = (a.origin.x + a.size.w < b.origin.x + b.size.w)? a.origin.x + a.size.w : b.origin.x + b.size.w;
+	int y1 = (a.origin.y + a.size.h < b.origin.y + b.size.h)? a.origin.y + a.size.h : b.origin.y + b.size.h;
+	if(x1 < x0)
+		x1 = x0;
+	if(y1 < y0)
+		y1 = y0;
+	return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+//drawing, every call lands in host_framebuffer through the context's offset and clip
+struct GContext {
+	GPoint offset; //screen position of the layer being drawn
+	GRect clip; //screen coordinates
+	GColor fill_color;
+	GColor stroke_color;
+	GColor text_color;
+};
+
+static GContext context;
+
+static void set_pixel(GContext* ctx, int x, int y, GColor color) //x and y relative to the layer
+{
+	if(color == GColorClear)
+		return;
+	x += ctx->offset.x;
+	y += ctx->offset.y;
+	if(x < ctx->clip.origin.x || y < ctx->clip.origin.y || x >= ctx->clip.origin.x + ctx->clip.size.w || y >= ctx->clip.origin.y + ctx->clip.size.h)
+		return;
+
+	uint8_t bit = 1 << (x % 8);
+	if(color == GColorWhite)
+		host_framebuffer[y][x / 8] |= bit;
+	else
+		host_framebuffer[y][x / 8] &= ~bit;
+}
+
+static char outside_corner(GRect rect, int x, int y, int radius, GCornerMask corners) //pixel cut away by a rounded corner
+{
+	if(radius <= 0)
+		return 0;
+
+	int dx = -1, dy = -1;
+	GCornerMask corner = GCornerNone;
+	if(x < radius && y < radius)
+		{ dx = radius - 1 - x; dy = radius - 1 - y; corner = GCornerTopLeft; }
+	else if(x >= rect.size.w - radius && y < radius)
+		{ dx = x - (rect.size.w - radius); dy = radius - 1 - y; corner = GCornerTopRight; }
+	else if(x < radius && y >= rect.size.h - radius)
+		{ dx = radius - 1 - x; dy = y - (rect.size.h - radius); corner = GCornerBottomLeft; }
+	else if(x >= rect.size.w - radius && y >= rect.size.h - radius)
+		{ dx = x - (rect.size.w - radius); dy = y - (rect.size.h - radius); corner = GCornerBottomRight; }
+
+	return (corners & corner) && dx * dx + dy * dy > radius * radius;
+}
+
+void graphics_context_set_fill_color(GContext* ctx, GColor color)
+{
+	ctx->fill_color = color;
+}
+
+void graphics_context_set_stroke_color(GContext* ctx, GColor color)
+{
+	ctx->stroke_color = color;
+}
+
+void graphics_context_set_text_color(GContext* ctx, GColor color)
+{
+	ctx->text_color = color;
+}
+
+void graphics_fill_rect(GContext* ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask)
+{
+	for(int y = 0; y < rect.size.h; y++)
+	{
+		for(int x = 0; x < rect.size.w; x++)
+		{
+			if(!outside_corner(rect, x, y, corner_radius, corner_mask))
+				set_pixel(ctx, rect.origin.x + x, rect.origin.y + y, ctx->fill_color);
+		}
+	}
+}
+
+void graphics_draw_round_rect(GContext* ctx, GRect rect, uint16_t radius)
+{
+	for(int y = 0; y < rect.size.h; y++)
+	{
+		for(int x = 0; x < rect.size.w; x++)
+		{
+			char edge = x == 0 || y == 0 || x == rect.size.w - 1 || y == rect.size.h - 1;
+			if(edge && !outside_corner(rect, x, y, radius, GCornersAll))
+				set_pixel(ctx, rect.origin.x + x, rect.origin.y + y, ctx->stroke_color);
+		}
+	}
+}
+
+void graphics_draw_bitmap_in_rect(GContext* ctx, const GBitmap* bitmap, GRect rect)
+{
+	host_counters.bitmaps_drawn++;
+	const uint8_t* data = bitmap->addr;
+	int width = bitmap->bounds.size.w;
+	int height = bitmap->bounds.size.h;
+
+	//tiled when the rect is bigger than the bitmap, as on the watch
+	for(int y = 0; y < rect.size.h; y++)
+	{
+		const uint8_t* row = &data[((y % height) + bitmap->bounds.origin.y) * bitmap->row_size_bytes];
+		for(int x = 0; x < rect.size.w; x++)
+		{
+			int column = (x % width) + bitmap->bounds.origin.x;
+			set_pixel(ctx, rect.origin.x + x, rect.origin.y + y, (row[column / 8] >> (column % 8)) & 1);
+		}
+	}
+}
+
+//fonts, a fixed advance and line height per font, glyphs drawn as blocks
+struct GFontInfo {
+	const char* key;
+	int advance;
+	int line_height;
+	int glyph_w;
+	int glyph_h;
+};
+
+static struct GFontInfo fonts[] = {
+	{ FONT_KEY_GOTHIC_18, 7, 18, 5, 10 },
+	{ FONT_KEY_GOTHIC_24_BOLD, 10, 24, 8, 14 },
+	{ FONT_KEY_BITHAM_42_BOLD, 24, 42, 20, 30 }
+};
+
+GFont fonts_get_system_font(const char* font_key)
+{
+	for(unsigned i = 0; i < sizeof(fonts) / sizeof(fonts[0]); i++)
+	{
+		if(strcmp(fonts[i].key, font_key) == 0)
+			return &fonts[i];
+	}
+	return &fonts[0];
+}
+
+typedef void (*GlyphCallback)(GContext* ctx, GFont font, int x, int y, char c);
+
+//greedy word wrap, calls draw for every glyph placed when given, returns the size used
+static GSize layout_text(GContext* ctx, const char* text, GFont font, GRect box, GTextOverflowMode overflow_mode, GlyphCallback draw)
+{
+	int columns = box.size.w / font->advance;
+	int max_lines = box.size.h / font->line_height;
+	if(columns < 1)
+		columns = 1;
+	if(max_lines < 1)
+		max_lines = 1;
+
+	int lines = 0;
+	int widest = 0;
+	const char* c = text;
+	while(*c && lines < max_lines)
+	{
+		//take as many whole words as fit, or cut a word longer than the line
+		int length = 0;
+		int fit = 0;
+		while(c[length] && c[length] != '\n' && length < columns)
+		{
+			length++;
+			if(c[length] == ' ' || c[length] == '\0' || c[length] == '\n')
+				fit = length;
+		}
+		if(fit == 0 || c[length] == '\0' || c[length] == '\n')
+			fit = length;
+
+		char last_line = (lines == max_lines - 1) && c[fit] && overflow_mode == GTextOverflowModeTrailingEllipsis;
+		if(draw)
+		{
+			for(int i = 0; i < fit; i++)
+				draw(ctx, font, box.origin.x + i * font->advance, box.origin.y + lines * font->line_height, (last_line && i >= fit - 3)? '.' : c[i]);
+		}
+		if(fit * font->advance > widest)
+			widest = fit * font->advance;
+		lines++;
+
+		c += fit;
+		while(*c == ' ' || *c == '\n')
+			c++;
+	}
+	return GSize(widest, lines * font->line_height);
+}
+
+static void draw_glyph(GContext* ctx, GFont font, int x, int y, char c)
+{
+	if(c == ' ')
+		return;
+	int height = (c == '.')? 2 : font->glyph_h - (c % 4);
+	int top = font->line_height - 4 - height;
+	for(int row = 0; row < height; row++)
+	{
+		for(int col = 0; col < font->glyph_w; col++)
+			set_pixel(ctx, x + col, y + top + row, ctx->text_color);
+	}
+}
+
+void graphics_draw_text(GContext* ctx, const char* text, const GFont font, const GRect box, const GTextOverflowMode overflow_mode, const GTextAlignment alignment, const GTextLayoutCacheRef layout)
+{
+	host_counters.texts_drawn++;
+	layout_text(ctx, text, font, box, overflow_mode, draw_glyph);
+}
+
+GSize graphics_text_layout_get_content_size(const char* text, const GFont font, const GRect box, const GTextOverflowMode overflow_mode, const GTextAlignment alignment)
+{
+	host_counters.text_layouts++;
+	return layout_text(NULL, text, font, box, overflow_mode, NULL);
+}
+
+//layers
+struct Layer {
+	GRect frame;
+	LayerUpdateProc update_proc;
+	Layer* parent;
+	Layer* first_child;
+	Layer* next_sibling;
+};
+
+struct Window {
+	Layer root;
+	ClickConfigProvider click_config_provider;
+	char pushed;
+};
+
+static Window* top_window = NULL;
+static char window_dirty = 0;
+
+Layer* layer_create(GRect frame)
+{
+	Layer* layer = host_alloc(sizeof(Layer));
+	layer->frame = frame;
+	return layer;
+}
+
+void layer_destroy(Layer* layer)
+{
+	if(layer->parent)
+	{
+		Layer** link = &layer->parent->first_child;
+		while(*link && *link != layer)
+			link = &(*link)->next_sibling;
+		if(*link)
+			*link = layer->next_sibling;
+	}
+	host_free(layer);
+}
+
+void layer_set_update_proc(Layer* layer, LayerUpdateProc update_proc)
+{
+	layer->update_proc = update_proc;
+}
+
+GRect layer_get_frame(const Layer* layer)
+{
+	return layer->frame;
+}
+
+void layer_set_frame(Layer* layer, GRect frame)
+{
+	if(grect_equal(&frame, &layer->frame))
+		return;
+	layer->frame = frame;
+	host_counters.frame_sets++;
+	window_dirty = 1;
+}
+
+void layer_mark_dirty(Layer* layer)
+{
+	host_counters.dirty_marks++;
+	window_dirty = 1;
+}
+
+void layer_add_child(Layer* parent, Layer* child)
+{
+	Layer** link = &parent->first_child;
+	while(*link)
+		link = &(*link)->next_sibling;
+	*link = child;
+	child->parent = parent;
+	window_dirty = 1;
+}
+
+Window* window_create(void)
+{
+	Window* window = host_alloc(sizeof(Window));
+	window->root.frame = GRect(0, 0, HOST_SCREEN_W, HOST_SCREEN_H);
+	return window;
+}
+
+void window_destroy(Window* window)
+{
+	if(top_window == window)
+		top_window = NULL;
+	host_free(window);
+}
+
+void window_set_fullscreen(Window* window, bool enabled)
+{
+}
+
+void window_stack_push(Window* window, bool animated)
+{
+	top_window = window;
+	window->pushed = 1;
+	window_dirty = 1;
+	if(window->click_config_provider)
+		window->click_config_provider(window);
+}
+
+Layer* window_get_root_layer(const Window* window)
+{
+	return (Layer*)&window->root;
+}
+
+//rendering, the whole window is redrawn whenever anything in it is dirty
+static void draw_layer(Layer* layer, GPoint offset, GRect clip)
+{
+	GPoint origin = GPoint(offset.x + layer->frame.origin.x, offset.y + layer->frame.origin.y);
+	clip = intersect(clip, GRect(origin.x, origin.y, layer->frame.size.w, layer->frame.size.h));
+	if(clip.size.w == 0 || clip.size.h == 0)
+		return;
+
+	if(layer->update_proc)
+	{
+		context = (GContext){ .offset = origin, .clip = clip, .fill_color = GColorBlack, .stroke_color = GColorBlack, .text_color = GColorBlack };
+		host_counters.update_procs++;
+		layer->update_proc(layer, &context);
+	}
+	for(Layer* child = layer->first_child; child; child = child->next_sibling)
+		draw_layer(child, origin, clip);
+}
+
+static uint64_t wall_ns(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000u + time.tv_nsec;
+}
+
+void host_render_all(void)
+{
+	if(!top_window)
+		return;
+
+	uint64_t started = wall_ns();
+	memset(host_framebuffer, 0xFF, sizeof(host_framebuffer));
+	draw_layer(&top_window->root, GPoint(0, 0), GRect(0, 0, HOST_SCREEN_W, HOST_SCREEN_H));
+	host_counters.render_ns += wall_ns() - started;
+	host_counters.renders++;
+	window_dirty = 0;
+}
+
+char host_render(void)
+{
+	if(!window_dirty)
+		return 0;
+	host_render_all();
+	return 1;
+}
+
+GContext* host_context(void)
+{
+	context = (GContext){ .offset = GPoint(0, 0), .clip = GRect(0, 0, HOST_SCREEN_W, HOST_SCREEN_H) };
+	return &context;
+}
+
+uint32_t host_framebuffer_checksum(void) //FNV-1a over the visible pixels, padding left out
+{
+	uint32_t hash = 2166136261u;
+	for(int y = 0; y < HOST_SCREEN_H; y++)
+	{
+		for(int x = 0; x < HOST_SCREEN_W / 8; x++)
+			hash = (hash ^ host_framebuffer[y][x]) * 16777619u;
+	}
+	return hash;
+}
+
+void host_write_pbm(FILE* file) //P4, where a set bit is black
+{
+	fprintf(file, "P4\n%d %d\n", HOST_SCREEN_W, HOST_SCREEN_H);
+	for(int y = 0; y < HOST_SCREEN_H; y++)
+	{
+		for(int x = 0; x < HOST_SCREEN_W / 8; x++)
+		{
+			uint8_t byte = host_framebuffer[y][x];
+			uint8_t out = 0;
+			for(int bit = 0; bit < 8; bit++)
+				out |= (((byte >> bit) & 1) ^ 1) << (7 - bit);
+			fputc(out, file);
+		}
+	}
+}
+
+//buttons
+typedef struct {
+	ClickHandler raw_down;
+	ClickHandler raw_up;
+	void* raw_context;
+	ClickHandler long_down;
+	ClickHandler long_up;
+	uint16_t long_delay;
+	char held;
+	char long_fired;
+	uint32_t pressed_at;
+} Button;
+
+static Button buttons[NUM_BUTTONS];
+
+void window_set_click_config_provider(Window* window, ClickConfigProvider click_config_provider)
+{
+	window->click_config_provider = click_config_provider;
+	if(window->pushed)
+		click_config_provider(window);
+}
+
+void window_raw_click_subscribe(ButtonId button_id, ClickHandler down_handler, ClickHandler up_handler, void* context)
+{
+	buttons[button_id].raw_down = down_handler;
+	buttons[button_id].raw_up = up_handler;
+	buttons[button_id].raw_context = context;
+}
+
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms, ClickHandler down_handler, ClickHandler up_handler)
+{
+	buttons[button_id].long_down = down_handler;
+	buttons[button_id].long_up = up_handler;
+	buttons[button_id].long_delay = (delay_ms)? delay_ms : 500;
+}
+
+static void long_press(void* data)
+{
+	Button* button = data;
+	if(!button->held || button->long_fired || now - button->pressed_at < button->long_delay)
+		return;
+	button->long_fired = 1;
+	if(button->long_down)
+		button->long_down(NULL, NULL);
+}
+
+static HostButtonHook button_hook = NULL;
+static void* button_hook_context = NULL;
+
+void host_set_button_hook(HostButtonHook hook, void* context)
+{
+	button_hook = hook;
+	button_hook_context = context;
+}
+
+void host_button_down(ButtonId button_id)
+{
+	if(button_hook)
+		button_hook(button_id, 1, button_hook_context);
+	Button* button = &buttons[button_id];
+	button->held = 1;
+	button->long_fired = 0;
+	button->pressed_at = now;
+	if(button->raw_down)
+		button->raw_down(NULL, button->raw_context);
+	if(button->long_down)
+		host_schedule(now + button->long_delay, long_press, button);
+	host_render();
+}
+
+void host_button_up(ButtonId button_id)
+{
+	if(button_hook)
+		button_hook(button_id, 0, button_hook_context);
+	Button* button = &buttons[button_id];
+	button->held = 0;
+	if(button->raw_up)
+		button->raw_up(NULL, button->raw_context);
+	if(button->long_fired && button->long_up)
+		button->long_up(NULL, NULL);
+	host_render();
+}
+
+void host_click(ButtonId button)
+{
+	host_button_down(button);
+	host_button_up(button);
+}
+
+//animation, one update per HOST_FRAME_MS while scheduled
+struct Animation {
+	const AnimationImplementation* implementation;
+	AnimationHandlers handlers;
+	void* context;
+	AnimationCurve curve;
+	uint32_t duration;
+	uint32_t started_at;
+	char scheduled;
+	Animation* next;
+};
+
+static Animation* animations = NULL;
+static uint32_t next_frame = 0;
+
+Animation* animation_create(void)
+{
+	Animation* animation = host_alloc(sizeof(Animation));
+	animation->duration = 250;
+	animation->next = animations;
+	animations = animation;
+	return animation;
+}
+
+void animation_destroy(Animation* animation)
+{
+	animation_unschedule(animation);
+	Animation** link = &animations;
+	while(*link && *link != animation)
+		link = &(*link)->next;
+	if(*link)
+		*link = animation->next;
+	host_free(animation);
+}
+
+void animation_set_implementation(Animation* animation, const AnimationImplementation* implementation)
+{
+	animation->implementation = implementation;
+}
+
+void animation_set_handlers(Animation* animation, AnimationHandlers callbacks, void* context)
+{
+	animation->handlers = callbacks;
+	animation->context = context;
+}
+
+void animation_set_curve(Animation* animation, AnimationCurve curve)
+{
+	animation->curve = curve;
+}
+
+void animation_set_duration(Animation* animation, uint32_t duration_ms)
+{
+	animation->duration = duration_ms;
+}
+
+void animation_schedule(Animation* animation)
+{
+	if(animation->scheduled)
+		animation_unschedule(animation);
+
+	host_counters.animations_scheduled++;
+	animation->scheduled = 1;
+	animation->started_at = now;
+	if(animation->implementation && animation->implementation->setup)
+		animation->implementation->setup(animation);
+	if(animation->handlers.started)
+		animation->handlers.started(animation, animation->context);
+	next_frame = now;
+}
+
+static void stop_animation(Animation* animation, bool finished)
+{
+	animation->scheduled = 0;
+	if(animation->handlers.stopped)
+		animation->handlers.stopped(animation, finished, animation->context);
+	if(animation->implementation && animation->implementation->teardown && !animation->scheduled)
+		animation->implementation->teardown(animation);
+}
+
+void animation_unschedule(Animation* animation)
+{
+	if(animation->scheduled)
+		stop_animation(animation, false);
+}
+
+bool animation_is_scheduled(Animation* animation)
+{
+	return animation->scheduled;
+}
+
+static uint32_t curve_progress(AnimationCurve curve, uint32_t progress)
+{
+	uint64_t t = progress;
+	switch(curve)
+	{
+		case AnimationCurveEaseIn:
+			return t * t / ANIMATION_NORMALIZED_MAX;
+		case AnimationCurveEaseOut:
+			return ANIMATION_NORMALIZED_MAX - (ANIMATION_NORMALIZED_MAX - t) * (ANIMATION_NORMALIZED_MAX - t) / ANIMATION_NORMALIZED_MAX;
+		default:
+			return progress;
+	}
+}
+
+static char animations_running(void)
+{
+	for(Animation* animation = animations; animation; animation = animation->next)
+	{
+		if(animation->scheduled)
+			return 1;
+	}
+	return 0;
+}
+
+static void animation_frame(void)
+{
+	for(Animation* animation = animations; animation; animation = animation->next)
+	{
+		if(!animation->scheduled)
+			continue;
+
+		uint32_t elapsed = now - animation->started_at;
+		uint32_t progress = (animation->duration == 0 || elapsed >= animation->duration)? ANIMATION_NORMALIZED_MAX : (uint64_t)elapsed * ANIMATION_NORMALIZED_MAX / animation->duration;
+		host_counters.animation_updates++;
+		if(animation->implementation && animation->implementation->update)
+			animation->implementation->update(animation, curve_progress(animation->curve, progress));
+		if(progress == ANIMATION_NORMALIZED_MAX && animation->scheduled)
+			stop_animation(animation, true);
+	}
+	next_frame = now + HOST_FRAME_MS;
+}
+
+//timers and scheduled events share one queue
+struct AppTimer {
+	uint32_t time;
+	AppTimerCallback callback;
+	void* data;
+	char heap; //registered by the app, counted against the heap
+	AppTimer* next;
+};
+
+static AppTimer* timers = NULL;
+
+static AppTimer* add_timer(uint32_t time, AppTimerCallback callback, void* data, char heap)
+{
+	AppTimer* timer = (heap)? host_alloc(sizeof(AppTimer)) : calloc(1, sizeof(AppTimer));
+	*timer = (AppTimer){ .time = time, .callback = callback, .data = data, .heap = heap, .next = timers };
+	timers = timer;
+	return timer;
+}
+
+static char unlink_timer(AppTimer* timer)
+{
+	AppTimer** link = &timers;
+	while(*link && *link != timer)
+		link = &(*link)->next;
+	if(!*link)
+		return 0;
+	*link = timer->next;
+	return 1;
+}
+
+static void free_timer(AppTimer* timer)
+{
+	if(timer->heap)
+		host_free(timer);
+	else
+		free(timer);
+}
+
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void* callback_data)
+{
+	return add_timer(now + timeout_ms, callback, callback_data, 1);
+}
+
+bool app_timer_reschedule(AppTimer* timer_handle, uint32_t new_timeout_ms)
+{
+	for(AppTimer* timer = timers; timer; timer = timer->next)
+	{
+		if(timer == timer_handle)
+		{
+			timer->time = now + new_timeout_ms;
+			return true;
+		}
+	}
+	return false;
+}
+
+void app_timer_cancel(AppTimer* timer_handle)
+{
+	if(unlink_timer(timer_handle))
+		free_timer(timer_handle);
+}
+
+void host_schedule(uint32_t time, HostEvent event, void* data)
+{
+	add_timer(time, event, data, 0);
+}
+
+static AppTimer* earliest_timer(void)
+{
+	AppTimer* earliest = NULL;
+	for(AppTimer* timer = timers; timer; timer = timer->next)
+	{
+		//ties go to the one registered first, which is further down the list
+		if(!earliest || timer->time <= earliest->time)
+			earliest = timer;
+	}
+	return earliest;
+}
+
+uint32_t host_now(void)
+{
+	return now;
+}
+
+uint32_t host_trace_us(void)
+{
+	static uint32_t traced_ms = 0;
+	static uint64_t traced_since = 0;
+	if(now != traced_ms || !traced_since)
+	{
+		traced_ms = now;
+		traced_since = wall_ns();
+	}
+	return now * 1000 + (uint32_t)((wall_ns() - traced_since) / 1000);
+}
+
+void host_run_until(uint32_t time)
+{
+	for(;;)
+	{
+		AppTimer* timer = earliest_timer();
+		char frame_due = animations_running() && next_frame <= time;
+
+		if(frame_due && (!timer || next_frame <= timer->time))
+		{
+			if(next_frame > now)
+				now = next_frame;
+			animation_frame();
+		}
+		else if(timer && timer->time <= time)
+		{
+			if(timer->time > now)
+				now = timer->time;
+			unlink_timer(timer);
+			if(timer->heap)
+				host_counters.timers_fired++;
+			timer->callback(timer->data);
+			free_timer(timer);
+		}
+		else
+			break;
+		host_render();
+	}
+	if(time > now)
+		now = time;
+	host_render();
+}
+
+void host_run_for(uint32_t ms)
+{
+	host_run_until(now + ms);
+}
+
+char host_idle(void)
+{
+	return !animations_running() && !window_dirty;
+}
+
+//time, starting at 10:00 on the first day
+#define HOST_EPOCH (10 * 3600)
+
+uint16_t time_ms(time_t* tloc, uint16_t* out_ms)
+{
+	if(tloc)
+		*tloc = HOST_EPOCH + now / 1000;
+	if(out_ms)
+		*out_ms = now % 1000;
+	return now % 1000;
+}
+
+void clock_copy_time_string(char* buffer, uint8_t size)
+{
+	uint32_t minutes = HOST_EPOCH / 60 + now / 60000;
+	snprintf(buffer, size, "%u:%02u", (minutes / 60) % 24, minutes % 60);
+}
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler)
+{
+}
+
+//dictionaries
+#define TUPLE_HEADER_SIZE 7
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...)
+{
+	uint32_t size = 1 + tuple_count * TUPLE_HEADER_SIZE;
+	va_list sizes;
+	va_start(sizes, tuple_count);
+	for(int i = 0; i < tuple_count; i++)
+		size += va_arg(sizes, uint32_t);
+	va_end(sizes);
+	return size;
+}
+
+uint32_t dict_size(DictionaryIterator* iter)
+{
+	return (uint8_t*)iter->end - (uint8_t*)iter->dictionary;
+}
+
+DictionaryResult dict_write_begin(DictionaryIterator* iter, uint8_t* const buffer, const uint16_t size)
+{
+	if(!iter || !buffer || size < 1)
+		return DICT_INVALID_ARGS;
+	iter->dictionary = (Dictionary*)buffer;
+	iter->dictionary->count = 0;
+	iter->cursor = iter->dictionary->head;
+	iter->end = buffer + size;
+	return DICT_OK;
+}
+
+static DictionaryResult write_tuple(DictionaryIterator* iter, uint32_t key, TupleType type, const void* data, uint16_t length)
+{
+	if((uint8_t*)iter->cursor + TUPLE_HEADER_SIZE + length > (uint8_t*)iter->end)
+		return DICT_NOT_ENOUGH_STORAGE;
+
+	Tuple* tuple = iter->cursor;
+	tuple->key = key;
+	tuple->type = type;
+	tuple->length = length;
+	memcpy(tuple->value->data, data, length);
+	iter->cursor = (Tuple*)((uint8_t*)tuple + TUPLE_HEADER_SIZE + length);
+	iter->dictionary->count++;
+	return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator* iter, const uint32_t key, const uint8_t* const data, const uint16_t size)
+{
+	return write_tuple(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_int(DictionaryIterator* iter, const uint32_t key, const void* integer, const uint8_t width_bytes, const bool is_signed)
+{
+	if(width_bytes != 1 && width_bytes != 2 && width_bytes != 4)
+		return DICT_INVALID_ARGS;
+	return write_tuple(iter, key, (is_signed)? TUPLE_INT : TUPLE_UINT, integer, width_bytes);
+}
+
+DictionaryResult dict_write_tuplet(DictionaryIterator* iter, const Tuplet* const tuplet)
+{
+	switch(tuplet->type)
+	{
+		case TUPLE_BYTE_ARRAY:
+			return write_tuple(iter, tuplet->key, TUPLE_BYTE_ARRAY, tuplet->bytes.data, tuplet->bytes.length);
+		case TUPLE_CSTRING:
+			return write_tuple(iter, tuplet->key, TUPLE_CSTRING, tuplet->cstring.data, tuplet->cstring.length);
+		default:
+			//little endian, the low bytes of storage hold the value at any width
+			return write_tuple(iter, tuplet->key, tuplet->type, &tuplet->integer.storage, tuplet->integer.width);
+	}
+}
+
+uint32_t dict_write_end(DictionaryIterator* iter)
+{
+	iter->end = iter->cursor;
+	iter->cursor = iter->dictionary->head;
+	return dict_size(iter);
+}
+
+Tuple* dict_read_begin_from_buffer(DictionaryIterator* iter, const uint8_t* const buffer, const uint16_t size)
+{
+	iter->dictionary = (Dictionary*)buffer;
+	iter->end = buffer + size;
+	return dict_read_first(iter);
+}
+
+static char tuple_fits(const DictionaryIterator* iter, const Tuple* tuple)
+{
+	return (const uint8_t*)tuple + TUPLE_HEADER_SIZE <= (const uint8_t*)iter->end &&
+		(const uint8_t*)tuple + TUPLE_HEADER_SIZE + tuple->length <= (const uint8_t*)iter->end;
+}
+
+Tuple* dict_read_first(DictionaryIterator* iter)
+{
+	iter->cursor = iter->dictionary->head;
+	if(iter->dictionary->count == 0 || !tuple_fits(iter, iter->cursor))
+		return NULL;
+	return iter->cursor;
+}
+
+Tuple* dict_read_next(DictionaryIterator* iter)
+{
+	Tuple* next = (Tuple*)((uint8_t*)iter->cursor + TUPLE_HEADER_SIZE + iter->cursor->length);
+	if(!tuple_fits(iter, next))
+		return NULL;
+	iter->cursor = next;
+	return next;
+}
+
+Tuple* dict_find(const DictionaryIterator* iter, const uint32_t key)
+{
+	Tuple* tuple = iter->dictionary->head;
+	for(int i = 0; i < iter->dictionary->count && tuple_fits(iter, tuple); i++)
+	{
+		if(tuple->key == key)
+			return tuple;
+		tuple = (Tuple*)((uint8_t*)tuple + TUPLE_HEADER_SIZE + tuple->length);
+	}
+	return NULL;
+}
+
+//app message
+static AppMessageInboxReceived inbox_received = NULL;
+static AppMessageInboxDropped inbox_dropped = NULL;
+static AppMessageOutboxSent outbox_sent = NULL;
+static AppMessageOutboxFailed outbox_failed = NULL;
+
+static uint32_t inbox_maximum = 656;
+static uint32_t inbox_size = 0;
+static uint32_t outbox_size = 0;
+static uint8_t* inbox_buffer = NULL;
+static uint8_t* outbox_buffer = NULL;
+static DictionaryIterator outbox_iter;
+static char outbox_open = 0; //between begin and send
+static char outbox_in_flight = 0;
+static uint32_t outbox_delay = 40;
+static uint32_t outbox_failures = 0;
+static HostOutboxHook outbox_hook = NULL;
+static void* outbox_hook_context = NULL;
+static HostInboxHook inbox_hook = NULL;
+static void* inbox_hook_context = NULL;
+static SniffInterval sniff_interval = SNIFF_INTERVAL_NORMAL;
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback)
+{
+	AppMessageInboxReceived old = inbox_received;
+	inbox_received = received_callback;
+	return old;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback)
+{
+	AppMessageInboxDropped old = inbox_dropped;
+	inbox_dropped = dropped_callback;
+	return old;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback)
+{
+	AppMessageOutboxSent old = outbox_sent;
+	outbox_sent = sent_callback;
+	return old;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback)
+{
+	AppMessageOutboxFailed old = outbox_failed;
+	outbox_failed = failed_callback;
+	return old;
+}
+
+uint32_t app_message_inbox_size_maximum(void)
+{
+	return inbox_maximum;
+}
+
+uint32_t app_message_outbox_size_maximum(void)
+{
+	return 656;
+}
+
+uint32_t host_inbox_maximum(void)
+{
+	return inbox_maximum;
+}
+
+void host_set_inbox_maximum(uint32_t size)
+{
+	inbox_maximum = size;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound)
+{
+	if(size_inbound > inbox_maximum)
+		return APP_MSG_OUT_OF_MEMORY;
+
+	//the buffers come out of the app heap, as on the watch
+	host_free(inbox_buffer);
+	host_free(outbox_buffer);
+	inbox_size = size_inbound;
+	outbox_size = size_outbound;
+	inbox_buffer = host_alloc(inbox_size);
+	outbox_buffer = host_alloc(outbox_size);
+	return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator** iterator)
+{
+	if(!outbox_buffer)
+		return APP_MSG_INVALID_ARGS;
+	if(outbox_in_flight || outbox_open)
+		return APP_MSG_BUSY;
+
+	dict_write_begin(&outbox_iter, outbox_buffer, outbox_size);
+	outbox_open = 1;
+	*iterator = &outbox_iter;
+	return APP_MSG_OK;
+}
+
+static void outbox_done(void* data)
+{
+	DictionaryIterator sent;
+	dict_read_begin_from_buffer(&sent, outbox_buffer, dict_size(&outbox_iter));
+	outbox_in_flight = 0;
+
+	if(outbox_failures > 0)
+	{
+		outbox_failures--;
+		host_counters.outbox_failed++;
+		if(outbox_failed)
+			outbox_failed(&sent, APP_MSG_SEND_TIMEOUT, NULL);
+		return;
+	}
+
+	host_counters.messages_out++;
+	host_counters.bytes_out += dict_size(&sent);
+	if(outbox_hook)
+		outbox_hook(outbox_buffer, dict_size(&sent), outbox_hook_context);
+	if(outbox_sent)
+		outbox_sent(&sent, NULL);
+}
+
+AppMessageResult app_message_outbox_send(void)
+{
+	if(!outbox_open)
+		return APP_MSG_INVALID_ARGS;
+
+	outbox_open = 0;
+	outbox_in_flight = 1;
+	outbox_iter.end = outbox_iter.cursor;
+	host_schedule(now + outbox_delay, outbox_done, NULL);
+	return APP_MSG_OK;
+}
+
+void host_set_outbox_hook(HostOutboxHook hook, void* context)
+{
+	outbox_hook = hook;
+	outbox_hook_context = context;
+}
+
+void host_set_inbox_hook(HostInboxHook hook, void* context)
+{
+	inbox_hook = hook;
+	inbox_hook_context = context;
+}
+
+void host_set_outbox_delay(uint32_t ms)
+{
+	outbox_delay = ms;
+}
+
+void host_fail_outbox(uint32_t count)
+{
+	outbox_failures = count;
+}
+
+AppMessageResult host_deliver(const uint8_t* dictionary, uint16_t size)
+{
+	if(inbox_hook)
+		inbox_hook(dictionary, size, inbox_hook_context);
+
+	if(!inbox_buffer || size > inbox_size)
+	{
+		host_counters.messages_dropped++;
+		if(inbox_dropped)
+			inbox_dropped(APP_MSG_BUFFER_OVERFLOW, NULL);
+		host_render();
+		return APP_MSG_BUFFER_OVERFLOW;
+	}
+
+	host_counters.messages_in++;
+	host_counters.bytes_in += size;
+	memcpy(inbox_buffer, dictionary, size);
+	DictionaryIterator iter;
+	dict_read_begin_from_buffer(&iter, inbox_buffer, size);
+	if(inbox_received)
+		inbox_received(&iter, NULL);
+	host_render();
+	return APP_MSG_OK;
+}
+
+void app_comm_set_sniff_interval(const SniffInterval interval)
+{
+	if(interval != sniff_interval)
+		host_counters.sniff_changes++;
+	sniff_interval = interval;
+}
+
+SniffInterval host_sniff_interval(void)
+{
+	return sniff_interval;
+}
+
+//persist, a flat table of keys holding no more than the watch gives an app
+#define HOST_PERSIST_KEYS 64
+#define HOST_PERSIST_SIZE 4096
+
+typedef struct {
+	uint32_t key;
+	uint16_t length;
+	char used;
+	uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} PersistEntry;
+
+static PersistEntry persist_entries[HOST_PERSIST_KEYS];
+
+static PersistEntry* find_entry(uint32_t key)
+{
+	for(int i = 0; i < HOST_PERSIST_KEYS; i++)
+	{
+		if(persist_entries[i].used && persist_entries[i].key == key)
+			return &persist_entries[i];
+	}
+	return NULL;
+}
+
+bool persist_exists(const uint32_t key)
+{
+	return find_entry(key) != NULL;
+}
+
+int persist_read_data(const uint32_t key, void* buffer, const size_t buffer_size)
+{
+	PersistEntry* entry = find_entry(key);
+	if(!entry)
+		return E_DOES_NOT_EXIST;
+	int length = (entry->length < buffer_size)? entry->length : (int)buffer_size;
+	memcpy(buffer, entry->data, length);
+	return length;
+}
+
+int persist_write_data(const uint32_t key, const void* data, const size_t size)
+{
+	PersistEntry* entry = find_entry(key);
+	for(int i = 0; i < HOST_PERSIST_KEYS && !entry; i++)
+	{
+		if(!persist_entries[i].used)
+			entry = &persist_entries[i];
+	}
+	if(!entry)
+		return E_OUT_OF_STORAGE;
+
+	int length = (size < PERSIST_DATA_MAX_LENGTH)? (int)size : PERSIST_DATA_MAX_LENGTH;
+	int stored = 0;
+	for(int i = 0; i < HOST_PERSIST_KEYS; i++)
+	{
+		if(persist_entries[i].used && &persist_entries[i] != entry)
+			stored += persist_entries[i].length;
+	}
+	if(stored + length > HOST_PERSIST_SIZE)
+		return E_OUT_OF_STORAGE;
+
+	entry->used = 1;
+	entry->key = key;
+	entry->length = length;
+	memcpy(entry->data, data, length);
+	return length;
+}
+
+int persist_delete(const uint32_t key)
+{
+	PersistEntry* entry = find_entry(key);
+	if(!entry)
+		return E_DOES_NOT_EXIST;
+	entry->used = 0;
+	return S_SUCCESS;
+}
+
+void host_persist_clear(void)
+{
+	memset(persist_entries, 0, sizeof(persist_entries));
+}
+
+void host_persist_save(FILE* file)
+{
+	fwrite(persist_entries, sizeof(persist_entries), 1, file);
+}
+
+void host_persist_load(FILE* file)
+{
+	if(fread(persist_entries, sizeof(persist_entries), 1, file) != 1)
+		host_persist_clear();
+}
@@ -0,0 +1,260 @@
+#pragma once
+//stand-in for the Pebble SDK header so src/main.c builds and runs on Linux
+//only what the app uses is here, with the SDK's names and signatures
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+//geometry
+typedef struct { int16_t x; int16_t y; } GPoint;
+typedef struct { int16_t w; int16_t h; } GSize;
+typedef struct { GPoint origin; GSize size; } GRect;
+
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GSize(w, h) ((GSize){(w), (h)})
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+
+bool grect_equal(const GRect* const rect_a, const GRect* const rect_b);
+
+//1bpp bitmap, a set bit is white
+typedef struct {
+	void* addr;
+	uint16_t row_size_bytes;
+	uint16_t info_flags;
+	GRect bounds;
+} GBitmap;
+
+typedef enum { GColorClear = -1, GColorBlack = 0, GColorWhite = 1 } GColor;
+
+typedef enum {
+	GCornerNone = 0,
+	GCornerTopLeft = 1,
+	GCornerTopRight = 2,
+	GCornerBottomLeft = 4,
+	GCornerBottomRight = 8,
+	GCornersAll = 15
+} GCornerMask;
+
+typedef struct GContext GContext;
+
+//text, fonts are fixed cell grids on the host
+typedef struct GFontInfo* GFont;
+typedef struct GTextLayoutCache* GTextLayoutCacheRef;
+typedef enum { GTextOverflowModeWordWrap, GTextOverflowModeTrailingEllipsis, GTextOverflowModeFill } GTextOverflowMode;
+typedef enum { GTextAlignmentLeft, GTextAlignmentCenter, GTextAlignmentRight } GTextAlignment;
+
+#define FONT_KEY_GOTHIC_18 "RESOURCE_ID_GOTHIC_18"
+#define FONT_KEY_GOTHIC_24_BOLD "RESOURCE_ID_GOTHIC_24_BOLD"
+#define FONT_KEY_BITHAM_42_BOLD "RESOURCE_ID_BITHAM_42_BOLD"
+
+GFont fonts_get_system_font(const char* font_key);
+
+void graphics_context_set_fill_color(GContext* ctx, GColor color);
+void graphics_context_set_stroke_color(GContext* ctx, GColor color);
+void graphics_context_set_text_color(GContext* ctx, GColor color);
+void graphics_fill_rect(GContext* ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+void graphics_draw_round_rect(GContext* ctx, GRect rect, uint16_t radius);
+void graphics_draw_bitmap_in_rect(GContext* ctx, const GBitmap* bitmap, GRect rect);
+void graphics_draw_text(GContext* ctx, const char* text, const GFont font, const GRect box, const GTextOverflowMode overflow_mode, const GTextAlignment alignment, const GTextLayoutCacheRef layout);
+GSize graphics_text_layout_get_content_size(const char* text, const GFont font, const GRect box, const GTextOverflowMode overflow_mode, const GTextAlignment alignment);
+
+//layers and windows
+typedef struct Layer Layer;
+typedef struct Window Window;
+typedef void (*LayerUpdateProc)(Layer* layer, GContext* ctx);
+
+Layer* layer_create(GRect frame);
+void layer_destroy(Layer* layer);
+void layer_set_update_proc(Layer* layer, LayerUpdateProc update_proc);
+GRect layer_get_frame(const Layer* layer);
+void layer_set_frame(Layer* layer, GRect frame);
+void layer_mark_dirty(Layer* layer);
+void layer_add_child(Layer* parent, Layer* child);
+
+Window* window_create(void);
+void window_destroy(Window* window);
+void window_set_fullscreen(Window* window, bool enabled);
+void window_stack_push(Window* window, bool animated);
+Layer* window_get_root_layer(const Window* window);
+
+//buttons
+typedef enum { BUTTON_ID_BACK, BUTTON_ID_UP, BUTTON_ID_SELECT, BUTTON_ID_DOWN, NUM_BUTTONS } ButtonId;
+typedef void* ClickRecognizerRef;
+typedef void (*ClickHandler)(ClickRecognizerRef recognizer, void* context);
+typedef void (*ClickConfigProvider)(void* context);
+
+void window_set_click_config_provider(Window* window, ClickConfigProvider click_config_provider);
+void window_raw_click_subscribe(ButtonId button_id, ClickHandler down_handler, ClickHandler up_handler, void* context);
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms, ClickHandler down_handler, ClickHandler up_handler);
+
+//animation
+#define ANIMATION_NORMALIZED_MIN 0
+#define ANIMATION_NORMALIZED_MAX 65535
+
+typedef struct Animation Animation;
+typedef enum { AnimationCurveLinear, AnimationCurveEaseIn, AnimationCurveEaseOut, AnimationCurveEaseInOut } AnimationCurve;
+typedef void (*AnimationSetupImplementation)(Animation* animation);
+typedef void (*AnimationUpdateImplementation)(Animation* animation, const uint32_t distance_normalized);
+typedef void (*AnimationTeardownImplementation)(Animation* animation);
+typedef void (*AnimationStartedHandler)(Animation* animation, void* context);
+typedef void (*AnimationStoppedHandler)(Animation* animation, bool finished, void* context);
+
+typedef struct {
+	AnimationSetupImplementation setup;
+	AnimationUpdateImplementation update;
+	AnimationTeardownImplementation teardown;
+} AnimationImplementation;
+
+typedef struct {
+	AnimationStartedHandler started;
+	AnimationStoppedHandler stopped;
+} AnimationHandlers;
+
+Animation* animation_create(void);
+void animation_destroy(Animation* animation);
+void animation_set_implementation(Animation* animation, const AnimationImplementation* implementation);
+void animation_set_handlers(Animation* animation, AnimationHandlers callbacks, void* context);
+void animation_set_curve(Animation* animation, AnimationCurve curve);
+void animation_set_duration(Animation* animation, uint32_t duration_ms);
+void animation_schedule(Animation* animation);
+void animation_unschedule(Animation* animation);
+bool animation_is_scheduled(Animation* animation);
+
+//timers and time
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void* data);
+
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void* callback_data);
+bool app_timer_reschedule(AppTimer* timer_handle, uint32_t new_timeout_ms);
+void app_timer_cancel(AppTimer* timer_handle);
+
+uint16_t time_ms(time_t* tloc, uint16_t* out_ms);
+void clock_copy_time_string(char* buffer, uint8_t size);
+
+typedef enum { SECOND_UNIT = 1, MINUTE_UNIT = 2, HOUR_UNIT = 4, DAY_UNIT = 8, MONTH_UNIT = 16, YEAR_UNIT = 32 } TimeUnits;
+typedef void (*TickHandler)(struct tm* tick_time, TimeUnits units_changed);
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+
+//dictionaries, laid out as on the watch: a count byte then packed tuples
+typedef enum { TUPLE_BYTE_ARRAY = 0, TUPLE_CSTRING = 1, TUPLE_UINT = 2, TUPLE_INT = 3 } TupleType;
+
+typedef struct __attribute__((__packed__)) {
+	uint32_t key;
+	uint8_t type;
+	uint16_t length;
+	union {
+		uint8_t data[0];
+		char cstring[0];
+		uint8_t uint8;
+		uint16_t uint16;
+		uint32_t uint32;
+		int8_t int8;
+		int16_t int16;
+		int32_t int32;
+	} value[];
+} Tuple;
+
+typedef struct __attribute__((__packed__)) {
+	uint8_t count;
+	Tuple head[];
+} Dictionary;
+
+typedef struct {
+	Dictionary* dictionary;
+	const void* end;
+	Tuple* cursor;
+} DictionaryIterator;
+
+typedef enum {
+	DICT_OK = 0,
+	DICT_NOT_ENOUGH_STORAGE = 1 << 1,
+	DICT_INVALID_ARGS = 1 << 2,
+	DICT_INTERNAL_INCONSISTENCY = 1 << 3
+} DictionaryResult;
+
+typedef struct {
+	TupleType type;
+	uint32_t key;
+	union {
+		struct { const uint8_t* data; uint16_t length; } bytes;
+		struct { const char* data; uint16_t length; } cstring;
+		struct { uint32_t storage; uint16_t width; } integer;
+	};
+} Tuplet;
+
+#define TupletBytes(_key, _data, _length) \
+	((const Tuplet) { .type = TUPLE_BYTE_ARRAY, .key = (_key), .bytes = { .data = (_data), .length = (_length) }})
+#define TupletInteger(_key, _integer) \
+	((const Tuplet) { .type = (((__typeof__(_integer))-1) < 0)? TUPLE_INT : TUPLE_UINT, .key = (_key), .integer = { .storage = (uint32_t)(_integer), .width = sizeof(_integer) }})
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...);
+uint32_t dict_size(DictionaryIterator* iter);
+DictionaryResult dict_write_begin(DictionaryIterator* iter, uint8_t* const buffer, const uint16_t size);
+DictionaryResult dict_write_data(DictionaryIterator* iter, const uint32_t key, const uint8_t* const data, const uint16_t size);
+DictionaryResult dict_write_int(DictionaryIterator* iter, const uint32_t key, const void* integer, const uint8_t width_bytes, const bool is_signed);
+DictionaryResult dict_write_tuplet(DictionaryIterator* iter, const Tuplet* const tuplet);
+uint32_t dict_write_end(DictionaryIterator* iter);
+Tuple* dict_read_begin_from_buffer(DictionaryIterator* iter, const uint8_t* const buffer, const uint16_t size);
+Tuple* dict_read_first(DictionaryIterator* iter);
+Tuple* dict_read_next(DictionaryIterator* iter);
+Tuple* dict_find(const DictionaryIterator* iter, const uint32_t key);
+
+//app message
+typedef enum {
+	APP_MSG_OK = 0,
+	APP_MSG_SEND_TIMEOUT = 1 << 1,
+	APP_MSG_SEND_REJECTED = 1 << 2,
+	APP_MSG_NOT_CONNECTED = 1 << 3,
+	APP_MSG_APP_NOT_RUNNING = 1 << 4,
+	APP_MSG_INVALID_ARGS = 1 << 5,
+	APP_MSG_BUSY = 1 << 6,
+	APP_MSG_BUFFER_OVERFLOW = 1 << 7,
+	APP_MSG_ALREADY_RELEASED = 1 << 9,
+	APP_MSG_CALLBACK_ALREADY_REGISTERED = 1 << 10,
+	APP_MSG_CALLBACK_NOT_REGISTERED = 1 << 11,
+	APP_MSG_OUT_OF_MEMORY = 1 << 12,
+	APP_MSG_CLOSED = 1 << 13,
+	APP_MSG_INTERNAL_ERROR = 1 << 14
+} AppMessageResult;
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator* iterator, void* context);
+typedef void (*AppMessageInboxDropped)(AppMessageResult reason, void* context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator* iterator, void* context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator* iterator, AppMessageResult reason, void* context);
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback);
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback);
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback);
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback);
+uint32_t app_message_inbox_size_maximum(void);
+uint32_t app_message_outbox_size_maximum(void);
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound);
+AppMessageResult app_message_outbox_begin(DictionaryIterator** iterator);
+AppMessageResult app_message_outbox_send(void);
+
+typedef enum { SNIFF_INTERVAL_NORMAL = 0, SNIFF_INTERVAL_REDUCED = 1 } SniffInterval;
+void app_comm_set_sniff_interval(const SniffInterval interval);
+
+//persist
+#define PERSIST_DATA_MAX_LENGTH 256
+
+typedef enum { S_SUCCESS = 0, E_ERROR = -1, E_DOES_NOT_EXIST = -10, E_OUT_OF_STORAGE = -11 } StatusCode;
+
+bool persist_exists(const uint32_t key);
+int persist_read_data(const uint32_t key, void* buffer, const size_t buffer_size);
+int persist_write_data(const uint32_t key, const void* data, const size_t size);
+int persist_delete(const uint32_t key);
+
+//heap and logging
+size_t heap_bytes_used(void);
+size_t heap_bytes_free(void);
+
+typedef enum { APP_LOG_LEVEL_ERROR = 1, APP_LOG_LEVEL_WARNING = 50, APP_LOG_LEVEL_INFO = 100, APP_LOG_LEVEL_DEBUG = 200, APP_LOG_LEVEL_DEBUG_VERBOSE = 255 } AppLogLevel;
+void app_log(uint8_t log_level, const char* src_filename, int src_line_number, const char* fmt, ...);
+#define APP_LOG(level, fmt, args...) app_log(level, __FILE__, __LINE__, fmt, ## args)
+
+void app_event_loop(void);
@@ -0,0 +1,894 @@
+//simulated phone for the host runner: the image corpus, the cards it streams and the link in between
+//built into the same unit as src/main.c, so it speaks the app's keys and packbits directly
+
+#include <math.h>
+
+#define PHONE_CARDS 32
+#define CORPUS_MAX 16
+#define ICON_KINDS 4
+#define IMAGE_ROW_BYTES (144/8)
+#define ICON_ROW_BYTES (48/8)
+#define PHONE_ACK_TIMEOUT 3000 //an asset sent without an ack by then goes again, the watch never saw its transfer
+
+//corpus, a set bit is white with the leftmost pixel in bit 0, rows tightly packed
+typedef struct {
+	char name[40];
+	uint8_t rows[144][IMAGE_ROW_BYTES];
+} CorpusImage;
+
+static CorpusImage corpus[CORPUS_MAX];
+static int corpus_count = 0;
+static uint8_t icons[ICON_KINDS][48][ICON_ROW_BYTES];
+static uint32_t icon_hashes[ICON_KINDS];
+
+static uint32_t random_state = 2463534242u;
+
+static uint32_t next_random(void) //xorshift, the same sequence every run
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+static void put_pixel(uint8_t* row, int x, int white)
+{
+	if(white)
+		row[x / 8] |= 1 << (x % 8);
+	else
+		row[x / 8] &= ~(1 << (x % 8));
+}
+
+static CorpusImage* corpus_add(const char* name)
+{
+	CorpusImage* image = &corpus[corpus_count++];
+	snprintf(image->name, sizeof(image->name), "%s", name);
+	memset(image->rows, 0, sizeof(image->rows));
+	return image;
+}
+
+//synthetic stand-ins for notification backgrounds, --images replaces them with real ones
+static void corpus_generate(void)
+{
+	static const int bayer[4][4] = { {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5} };
+
+	//banner: dark backdrop, a light panel with a dark badge
+	CorpusImage* image = corpus_add("banner");
+	for(int y = 0; y < 144; y++)
+		for(int x = 0; x < 144; x++)
+			put_pixel(image->rows[y], x, x >= 16 && x < 128 && y >= 24 && y < 104 && (x - 72) * (x - 72) + (y - 64) * (y - 64) > 400);
+
+	//page: lines of words on white
+	image = corpus_add("page");
+	for(int line = 0; line < 12; line++)
+	{
+		int x = 6;
+		while(x < 138)
+		{
+			int word = 6 + next_random() % 24;
+			for(int y = line * 12 + 2; y < line * 12 + 9; y++)
+				for(int col = x; col < x + word && col < 138; col++)
+					put_pixel(image->rows[y], col, 0);
+			x += word + 5;
+		}
+	}
+	for(int y = 0; y < 144; y++)
+		for(int x = 0; x < 144; x++)
+			if(!(y % 12 >= 2 && y % 12 < 9) || x < 6 || x >= 138)
+				put_pixel(image->rows[y], x, 1);
+	for(int y = 0; y < 144; y++)
+		for(int x = 6; x < 138; x++)
+			if(y % 12 >= 2 && y % 12 < 9 && !(image->rows[y][x / 8] & (1 << (x % 8))))
+				; //words stay black
+			else
+				put_pixel(image->rows[y], x, 1);
+
+	//gradient: an ordered dither of a diagonal ramp
+	image = corpus_add("gradient");
+	for(int y = 0; y < 144; y++)
+		for(int x = 0; x < 144; x++)
+			put_pixel(image->rows[y], x, bayer[y % 4][x % 4] < (x + y) * 17 / 288);
+
+	//photo: smooth shapes, error diffused
+	image = corpus_add("photo");
+	static float level[144][144];
+	for(int y = 0; y < 144; y++)
+		for(int x = 0; x < 144; x++)
+			level[y][x] = 0.5f + 0.3f * sinf(x / 11.0f + 1.3f) * cosf(y / 17.0f + 0.4f) + 0.2f * sinf((x + 2 * y) / 23.0f);
+	for(int y = 0; y < 144; y++)
+	{
+		for(int x = 0; x < 144; x++)
+		{
+			int white = level[y][x] >= 0.5f;
+			float error = level[y][x] - white;
+			put_pixel(image->rows[y], x, white);
+			if(x + 1 < 144) level[y][x + 1] += error * 7 / 16;
+			if(y + 1 < 144 && x > 0) level[y + 1][x - 1] += error * 3 / 16;
+			if(y + 1 < 144) level[y + 1][x] += error * 5 / 16;
+			if(y + 1 < 144 && x + 1 < 144) level[y + 1][x + 1] += error * 1 / 16;
+		}
+	}
+
+	//stripes: wide diagonal bands
+	image = corpus_add("stripes");
+	for(int y = 0; y < 144; y++)
+		for(int x = 0; x < 144; x++)
+			put_pixel(image->rows[y], x, ((x + y) / 12) % 2);
+}
+
+static int read_pbm_number(FILE* file)
+{
+	int c = fgetc(file);
+	while(c == '#' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+	{
+		if(c == '#')
+			while(c != '\n' && c != EOF)
+				c = fgetc(file);
+		c = fgetc(file);
+	}
+	int value = 0;
+	while(c >= '0' && c <= '9')
+	{
+		value = value * 10 + c - '0';
+		c = fgetc(file);
+	}
+	return value;
+}
+
+static char corpus_load_pbm(const char* path) //P4, cropped or padded with white to 144x144
+{
+	FILE* file = fopen(path, "rb");
+	if(!file || corpus_count == CORPUS_MAX || fgetc(file) != 'P' || fgetc(file) != '4')
+	{
+		fprintf(stderr, "%s: not a P4 image, or too many images\n", path);
+		if(file)
+			fclose(file);
+		return 0;
+	}
+
+	int width = read_pbm_number(file);
+	int height = read_pbm_number(file);
+	const char* name = strrchr(path, '/');
+	CorpusImage* image = corpus_add((name)? name + 1 : path);
+	memset(image->rows, 0xFF, sizeof(image->rows));
+
+	int row_bytes = (width + 7) / 8;
+	uint8_t row[row_bytes];
+	for(int y = 0; y < height && fread(row, row_bytes, 1, file) == 1; y++)
+	{
+		for(int x = 0; x < width && x < 144 && y < 144; x++)
+			put_pixel(image->rows[y], x, !(row[x / 8] & (0x80 >> (x % 8))));
+	}
+	fclose(file);
+	return 1;
+}
+
+static void icons_generate(void)
+{
+	for(int kind = 0; kind < ICON_KINDS; kind++)
+	{
+		for(int y = 0; y < 48; y++)
+		{
+			for(int x = 0; x < 48; x++)
+			{
+				int white;
+				if(kind == 0)
+					white = (x - 24) * (x - 24) + (y - 24) * (y - 24) < 300;
+				else if(kind == 1)
+					white = (x > 6 && x < 42 && y > 6 && y < 42) && !(x > 12 && x < 36 && y > 12 && y < 36);
+				else if(kind == 2)
+					white = (x > 8 && x < 14) || (x > 34 && x < 40) || (abs(x - 24) < 4 && y < 28 && y > 8 + abs(x - 24) * 2);
+				else
+					white = ((x / 4) + (y / 4)) % 2;
+				put_pixel(icons[kind][y], x, white);
+			}
+		}
+
+		uint32_t hash = 2166136261u;
+		for(int y = 0; y < 48; y++)
+			for(int i = 0; i < ICON_ROW_BYTES; i++)
+				hash = (hash ^ icons[kind][y][i]) * 16777619u;
+		icon_hashes[kind] = hash;
+	}
+}
+
+//phone
+typedef struct {
+	char rle; //UPDATEIMAGE_RLE and UPDATEICON_RLE instead of raw rows
+	char tracked; //TRANSFER and SEQUENCE on every chunk
+	char interlace; //raw backgrounds in interlaced passes
+	char batch; //BATCH messages filled with mixed work
+	char iconref; //ICONREF first, icon rows only when the watch needs them
+	int drop_percent; //icon and background chunks lost on the way to the watch, what TRANSFER and SEQUENCE recover from
+	uint32_t message_ms; //link cost of every message
+	uint32_t byte_us; //and of every byte
+} PhoneOptions;
+
+#define PHONE_DEFAULT ((PhoneOptions){ .rle = 1, .tracked = 1, .message_ms = 60, .byte_us = 500 })
+
+typedef struct {
+	int32_t transfer;
+	int32_t sequence; //next one sent
+	uint8_t needed[144/8]; //rows still to send
+	int rows;
+	char waiting; //every row is out, waiting for the watch's ack
+	uint32_t waiting_since;
+	char cancelled;
+	char done;
+	int pass; //next interlaced pass, INTERLACE_PASSES once every pass is out
+	int pass_index;
+} PhoneAsset;
+
+typedef struct {
+	char text_done;
+	char held; //evicted, not sent again until the watch views somewhere new
+	char icon_asked; //ICONREF out, no answer yet
+	PhoneAsset icon;
+	PhoneAsset image;
+} PhoneCard;
+
+typedef struct {
+	PhoneOptions options;
+	int total;
+	char text_only; //cards without icons or backgrounds
+	PhoneCard cards[PHONE_CARDS];
+	//what the watch told us
+	char connected;
+	int inbox;
+	int image_rows;
+	int icon_rows;
+	int viewing;
+	int direction;
+	//link
+	char link_busy;
+	char paused; //nothing is sent, for scenarios that drive the inbox themselves
+	int32_t next_transfer;
+	uint8_t in_flight[4096];
+	uint16_t in_flight_size;
+	char in_flight_chunk;
+	//results
+	uint32_t messages;
+	uint32_t bytes;
+	uint32_t lost;
+	uint32_t rows_sent;
+	uint32_t image_started_at; //first background chunk sent, 0 until then
+} Phone;
+
+static Phone phone;
+static uint8_t message[4096];
+static DictionaryIterator message_iter;
+
+static void phone_pump(void);
+
+//content of every card, made up from its number
+static const char* phone_titles[] = { "Alice", "Build server", "Calendar", "Dmitri Ivanov", "Eve" };
+static const char* phone_bodies[] = {
+	"Lunch?",
+	"Running late, start without me",
+	"Build 4512 failed on test_render: expected 0x3f but got 0x7f",
+	"Standup moved to 10:30 in the small room. Bring the numbers from last week and the slides if you have them.",
+	"ok"
+};
+
+static const char* phone_card_title(int card)
+{
+	return phone_titles[card % 5];
+}
+
+static const char* phone_card_body(int card)
+{
+	return phone_bodies[(card * 3) % 5];
+}
+
+static int phone_card_icon(int card)
+{
+	return (card / 3) % ICON_KINDS; //runs of cards from the same app
+}
+
+static int phone_card_image(int card)
+{
+	return card % corpus_count;
+}
+
+static const uint8_t* phone_row(int card, char image, int row)
+{
+	return (image)? corpus[phone_card_image(card)].rows[row] : icons[phone_card_icon(card)][row];
+}
+
+static void reset_asset(PhoneAsset* asset, int rows, char needed)
+{
+	*asset = (PhoneAsset){ .transfer = phone.next_transfer++, .rows = rows };
+	if(needed)
+		memset(asset->needed, 0xFF, sizeof(asset->needed));
+	else
+		asset->done = 1;
+}
+
+static void reset_icon(PhoneCard* state)
+{
+	state->icon_asked = 0;
+	reset_asset(&state->icon, 48, !phone.text_only && !phone.options.iconref);
+	if(!phone.text_only && phone.options.iconref)
+		state->icon.done = 0; //rows only once the watch answers the ICONREF
+}
+
+static void reset_phone_card(int card)
+{
+	PhoneCard* state = &phone.cards[card];
+	state->text_done = 0;
+	reset_icon(state);
+	reset_asset(&state->image, 144, !phone.text_only);
+}
+
+static char row_needed(PhoneAsset* asset, int row)
+{
+	return row < asset->rows && (asset->needed[row / 8] & (1 << (row % 8)));
+}
+
+static void row_sent(PhoneAsset* asset, int row)
+{
+	asset->needed[row / 8] &= ~(1 << (row % 8));
+}
+
+static int first_needed(PhoneAsset* asset)
+{
+	for(int row = 0; row < asset->rows; row++)
+	{
+		if(row_needed(asset, row))
+			return row;
+	}
+	return -1;
+}
+
+static void ack_timeout(void* data)
+{
+	PhoneAsset* asset = data;
+	if(!asset->waiting || host_now() - asset->waiting_since < PHONE_ACK_TIMEOUT)
+		return;
+	asset->waiting = 0;
+	memset(asset->needed, 0xFF, sizeof(asset->needed));
+	phone_pump();
+}
+
+static void asset_sent(PhoneAsset* asset) //call after rows go out, finishes the asset once every row has
+{
+	if(first_needed(asset) >= 0)
+		return;
+	if(phone.options.tracked)
+	{
+		asset->waiting = 1;
+		asset->waiting_since = host_now();
+		host_schedule(host_now() + PHONE_ACK_TIMEOUT, ack_timeout, asset);
+	}
+	else
+		asset->done = 1;
+}
+
+//messages
+static void message_begin(int command, int card)
+{
+	dict_write_begin(&message_iter, message, sizeof(message));
+	int32_t value = command;
+	dict_write_int(&message_iter, COMMAND, &value, 4, true);
+	if(card >= 0)
+	{
+		value = card;
+		dict_write_int(&message_iter, ID, &value, 4, true);
+	}
+}
+
+static void message_int(uint32_t key, int32_t value)
+{
+	dict_write_int(&message_iter, key, &value, 4, true);
+}
+
+static uint16_t message_end(void)
+{
+	return dict_write_end(&message_iter);
+}
+
+static int phone_chunk_overhead(char tracked, char pass) //dictionary bytes of a chunk besides its rows
+{
+	int keys = 4 + ((tracked)? 2 : 0) + ((pass)? 1 : 0); //COMMAND, ID, LINE and BYTES, then the optional ones
+	return 1 + keys * 7 + (keys - 1) * 4;
+}
+
+static int rle_rows(const uint8_t* first_row, int rows, int row_bytes, int budget, uint8_t* out, int* length) //rows that pack into budget
+{
+	uint8_t packed[64];
+	int count = 0;
+	*length = 0;
+	while(count < rows)
+	{
+		int size = pack_row(packed, (uint8_t*)first_row + count * row_bytes, row_bytes);
+		if(*length + size > budget)
+			break;
+		if(out)
+			memcpy(&out[*length], packed, size);
+		*length += size;
+		count++;
+	}
+	return count;
+}
+
+static int phone_rle_messages(const uint8_t* rows, int row_count, int row_bytes, char tracked) //messages an asset takes as packbits chunks
+{
+	int budget = phone.inbox - phone_chunk_overhead(tracked, 0);
+	int messages = 0;
+	int length;
+	for(int row = 0; row < row_count; messages++)
+		row += rle_rows(rows + row * row_bytes, row_count - row, row_bytes, budget, NULL, &length);
+	return messages;
+}
+
+static uint16_t chunk_message(int card, char image, int command, int line, const uint8_t* data, int length, int pass)
+{
+	PhoneAsset* asset = (image)? &phone.cards[card].image : &phone.cards[card].icon;
+	message_begin(command, card);
+	message_int(LINE, line);
+	dict_write_data(&message_iter, BYTES, data, length);
+	if(phone.options.tracked)
+	{
+		message_int(TRANSFER, asset->transfer);
+		message_int(SEQUENCE, asset->sequence++);
+	}
+	if(pass >= 0)
+		message_int(PASS, pass);
+	if(image && !phone.image_started_at)
+		phone.image_started_at = host_now();
+	return message_end();
+}
+
+static uint16_t interlaced_chunk(int card) //the next rows of the current pass
+{
+	PhoneAsset* asset = &phone.cards[card].image;
+	uint8_t data[4096];
+	int first = (asset->pass == 0)? 0 : 8 >> asset->pass;
+	int step = (asset->pass == 0)? 8 : 16 >> asset->pass;
+	int pass_rows = (144 - first + step - 1) / step;
+	int index = asset->pass_index;
+	int count = 0;
+
+	while(count < phone.image_rows && index + count < pass_rows)
+	{
+		int row = first + (index + count) * step;
+		memcpy(&data[count * IMAGE_ROW_BYTES], phone_row(card, 1, row), IMAGE_ROW_BYTES);
+		row_sent(asset, row);
+		count++;
+	}
+	uint16_t size = chunk_message(card, 1, UPDATEIMAGE, index, data, count * IMAGE_ROW_BYTES, asset->pass);
+
+	asset->pass_index += count;
+	if(asset->pass_index >= pass_rows)
+	{
+		asset->pass++;
+		asset->pass_index = 0;
+	}
+	phone.rows_sent += count;
+	asset_sent(asset);
+	return size;
+}
+
+static uint16_t chunk(int card, char image) //the next needed rows of an asset from the first one missing
+{
+	PhoneAsset* asset = (image)? &phone.cards[card].image : &phone.cards[card].icon;
+	int row_bytes = (image)? IMAGE_ROW_BYTES : ICON_ROW_BYTES;
+	uint8_t data[4096];
+	int length = 0;
+	int count = 0;
+
+	if(image && phone.options.interlace && asset->pass < INTERLACE_PASSES)
+		return interlaced_chunk(card);
+
+	int first = first_needed(asset);
+	int run = 0;
+	while(row_needed(asset, first + run))
+		run++;
+
+	if(phone.options.rle)
+	{
+		//rows are consecutive in the corpus, so they pack straight from it
+		count = rle_rows(phone_row(card, image, first), run, row_bytes, phone.inbox - phone_chunk_overhead(phone.options.tracked, 0), data, &length);
+	}
+	else
+	{
+		//as many rows as the watch said fit
+		int limit = (image)? phone.image_rows : phone.icon_rows;
+		for(count = 0; count < run && count < limit; count++)
+			memcpy(&data[count * row_bytes], phone_row(card, image, first + count), row_bytes);
+		length = count * row_bytes;
+	}
+
+	for(int row = first; row < first + count; row++)
+		row_sent(asset, row);
+	phone.rows_sent += count;
+
+	int command = (image)? ((phone.options.rle)? UPDATEIMAGE_RLE : UPDATEIMAGE) : ((phone.options.rle)? UPDATEICON_RLE : UPDATEICON);
+	uint16_t size = chunk_message(card, image, command, first, data, length, -1);
+	asset_sent(asset);
+	return size;
+}
+
+static int text_bytes(int card, uint8_t* out) //title then body, no terminators
+{
+	int title_length = strlen(phone_card_title(card));
+	int body_length = strlen(phone_card_body(card));
+	memcpy(out, phone_card_title(card), title_length);
+	memcpy(out + title_length, phone_card_body(card), body_length);
+	return title_length + body_length;
+}
+
+static uint16_t text_message(int card)
+{
+	uint8_t data[512];
+	int length = text_bytes(card, data);
+	message_begin(UPDATETEXT, card);
+	message_int(TOTAL, phone.total);
+	message_int(TITLE_LENGTH, strlen(phone_card_title(card)));
+	dict_write_data(&message_iter, BYTES, data, length);
+	phone.cards[card].text_done = 1;
+	return message_end();
+}
+
+static uint16_t iconref_message(int card)
+{
+	message_begin(ICONREF, card);
+	message_int(HASH, (int32_t)icon_hashes[phone_card_icon(card)]);
+	phone.cards[card].icon_asked = 1;
+	return message_end();
+}
+
+static char asset_ready(PhoneAsset* asset) //has rows to send now
+{
+	return !asset->done && !asset->cancelled && first_needed(asset) >= 0;
+}
+
+//one BATCH message, every record packed from the same work order as single messages
+static uint16_t batch_message(const int* order, int count)
+{
+	uint8_t data[4096];
+	int budget = phone.inbox - (1 + 3 * 7 + 2 * 4); //COMMAND, TOTAL and BYTES
+	int length = 0;
+
+	for(int n = 0; n < count; n++)
+	{
+		int card = order[n];
+		PhoneCard* state = &phone.cards[card];
+		BatchRecord record = { .card = card, .transfer = -1, .sequence = -1 };
+
+		if(!state->text_done && budget - length >= (int)sizeof(record) + 150)
+		{
+			record.command = UPDATETEXT;
+			record.line = strlen(phone_card_title(card));
+			record.length = text_bytes(card, &data[length + sizeof(record)]);
+			memcpy(&data[length], &record, sizeof(record));
+			length += sizeof(record) + record.length;
+			state->text_done = 1;
+		}
+
+		for(int image = 0; image < 2; image++)
+		{
+			PhoneAsset* asset = (image)? &state->image : &state->icon;
+			int room = budget - length - (int)sizeof(record);
+			if(!asset_ready(asset) || room < 32)
+				continue;
+
+			int row_bytes = (image)? IMAGE_ROW_BYTES : ICON_ROW_BYTES;
+			int first = first_needed(asset);
+			int run = 0;
+			while(row_needed(asset, first + run))
+				run++;
+			int packed;
+			int rows = rle_rows(phone_row(card, image, first), run, row_bytes, room, &data[length + sizeof(record)], &packed);
+			if(rows == 0)
+				continue;
+
+			record.command = (image)? UPDATEIMAGE_RLE : UPDATEICON_RLE;
+			record.line = first;
+			record.length = packed;
+			if(phone.options.tracked)
+			{
+				record.transfer = asset->transfer;
+				record.sequence = asset->sequence++;
+			}
+			memcpy(&data[length], &record, sizeof(record));
+			length += sizeof(record) + packed;
+			for(int row = first; row < first + rows; row++)
+				row_sent(asset, row);
+			phone.rows_sent += rows;
+			if(image && !phone.image_started_at)
+				phone.image_started_at = host_now();
+			asset_sent(asset);
+		}
+	}
+	if(length == 0)
+		return 0;
+
+	message_begin(BATCH, -1);
+	message_int(TOTAL, phone.total);
+	dict_write_data(&message_iter, BYTES, data, length);
+	return message_end();
+}
+
+static int priority_order(int* order) //cards the phone streams, the one being viewed first, then ahead of it
+{
+	int candidates[4] = { phone.viewing, phone.viewing + phone.direction, phone.viewing + 2 * phone.direction, phone.viewing - phone.direction };
+	int count = 0;
+	for(int i = 0; i < 4; i++)
+	{
+		int card = candidates[i];
+		char seen = 0;
+		for(int n = 0; n < count; n++)
+			seen |= order[n] == card;
+		if(card >= 0 && card < phone.total && !seen && !phone.cards[card].held)
+			order[count++] = card;
+	}
+	return count;
+}
+
+static uint16_t next_message(void)
+{
+	int order[4];
+	int count = priority_order(order);
+
+	if(phone.options.batch)
+		return batch_message(order, count);
+
+	for(int n = 0; n < count; n++)
+	{
+		int card = order[n];
+		PhoneCard* state = &phone.cards[card];
+		if(!state->text_done)
+			return text_message(card);
+		if(phone.options.iconref && !phone.text_only && !state->icon_asked && !state->icon.done && first_needed(&state->icon) < 0)
+			return iconref_message(card);
+		if(asset_ready(&state->icon))
+			return chunk(card, 0);
+		if(asset_ready(&state->image))
+			return chunk(card, 1);
+	}
+	return 0;
+}
+
+//link, one message on the air at a time
+static void phone_arrived(void* data)
+{
+	phone.link_busy = 0;
+	if(phone.in_flight_chunk && phone.options.drop_percent > 0 && (int)(next_random() % 100) < phone.options.drop_percent)
+		phone.lost++;
+	else
+		host_deliver(phone.in_flight, phone.in_flight_size);
+	phone_pump();
+}
+
+static void phone_pump(void)
+{
+	if(phone.link_busy || !phone.connected || phone.paused)
+		return;
+
+	uint16_t size = next_message();
+	if(size == 0)
+		return;
+
+	memcpy(phone.in_flight, message, size);
+	phone.in_flight_size = size;
+	DictionaryIterator iter;
+	dict_read_begin_from_buffer(&iter, message, size);
+	int command = dict_find(&iter, COMMAND)->value->int32;
+	phone.in_flight_chunk = command == UPDATEICON || command == UPDATEIMAGE || command == UPDATEICON_RLE || command == UPDATEIMAGE_RLE;
+	phone.messages++;
+	phone.bytes += size;
+	phone.link_busy = 1;
+	host_schedule(host_now() + phone.options.message_ms + size * phone.options.byte_us / 1000, phone_arrived, NULL);
+}
+
+//what the watch sends back
+static PhoneAsset* find_transfer(int32_t transfer, int* card)
+{
+	for(int i = 0; i < phone.total; i++)
+	{
+		if(phone.cards[i].icon.transfer == transfer)
+			return *card = i, &phone.cards[i].icon;
+		if(phone.cards[i].image.transfer == transfer)
+			return *card = i, &phone.cards[i].image;
+	}
+	return NULL;
+}
+
+static uint32_t phone_card_hash(int card, char shared_icon) //what hash_card() works out once the card is complete
+{
+	uint8_t packed[64];
+	uint32_t hash = 2166136261u;
+	for(const char* c = phone_card_title(card); *c; c++)
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+	for(const char* c = phone_card_body(card); *c; c++)
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+
+	if(shared_icon)
+	{
+		for(int i = 0; i < 4; i++)
+			hash = (hash ^ ((icon_hashes[phone_card_icon(card)] >> (8 * i)) & 0xFF)) * 16777619u;
+	}
+	else
+	{
+		for(int row = 0; row < 48; row++)
+			hash = hash_packed(hash, packed, pack_row(packed, (uint8_t*)phone_row(card, 0, row), ICON_ROW_BYTES));
+	}
+	for(int row = 0; row < 144; row++)
+		hash = hash_packed(hash, packed, pack_row(packed, (uint8_t*)phone_row(card, 1, row), IMAGE_ROW_BYTES));
+	return hash;
+}
+
+static void card_evicted(int32_t card)
+{
+	if(card >= 0 && card < phone.total)
+	{
+		reset_phone_card(card);
+		phone.cards[card].held = 1;
+	}
+}
+
+static void phone_received(const uint8_t* dictionary, uint16_t size, void* context)
+{
+	DictionaryIterator iter;
+	Tuple* tuple;
+	dict_read_begin_from_buffer(&iter, dictionary, size);
+
+	if((tuple = dict_find(&iter, IMAGE_ROWS)))
+	{
+		phone.image_rows = tuple->value->int32;
+		phone.icon_rows = dict_find(&iter, ICON_ROWS)->value->int32;
+		phone.inbox = dict_find(&iter, INBOX_SIZE)->value->int32;
+		phone.connected = 1;
+	}
+
+	if((tuple = dict_find(&iter, VIEWING)))
+	{
+		phone.viewing = tuple->value->int32;
+		phone.direction = dict_find(&iter, DIRECTION)->value->int32;
+		for(int card = 0; card < phone.total; card++)
+			phone.cards[card].held = 0;
+
+		//parts the phone thought were there but the watch still lacks
+		Tuple* needed = dict_find(&iter, NEEDED);
+		if(needed && phone.viewing < phone.total)
+		{
+			PhoneCard* state = &phone.cards[phone.viewing];
+			if(needed->value->int32 & TEXT_LOADED)
+				state->text_done = 0;
+			if((needed->value->int32 & ICON_LOADED) && state->icon.done && !phone.text_only)
+				reset_icon(state);
+			if((needed->value->int32 & IMAGE_LOADED) && state->image.done && !phone.text_only)
+				reset_asset(&state->image, 144, 1);
+		}
+	}
+
+	if((tuple = dict_find(&iter, EVICTED)))
+	{
+		if(tuple->type == TUPLE_BYTE_ARRAY)
+		{
+			for(int i = 0; i + 4 <= tuple->length; i += 4)
+			{
+				int32_t card;
+				memcpy(&card, tuple->value->data + i, 4);
+				card_evicted(card);
+			}
+		}
+		else
+			card_evicted(tuple->value->int32);
+	}
+
+	if((tuple = dict_find(&iter, TRANSFER)))
+	{
+		int card;
+		PhoneAsset* asset = find_transfer(tuple->value->int32, &card);
+		Tuple* ack = dict_find(&iter, ACK);
+		Tuple* missing = dict_find(&iter, MISSING);
+		Tuple* missing_rows = dict_find(&iter, MISSING_ROWS);
+		if(asset && ack && ack->value->int32 >= asset->rows)
+		{
+			asset->done = 1;
+			asset->waiting = 0;
+		}
+		else if(asset && missing && missing_rows && missing->value->int32 >= 0)
+		{
+			//resend the run the watch is missing
+			asset->cancelled = 0;
+			asset->waiting = 0;
+			asset->done = 0;
+			for(int row = missing->value->int32; row < missing->value->int32 + missing_rows->value->int32 && row < asset->rows; row++)
+				asset->needed[row / 8] |= 1 << (row % 8);
+		}
+	}
+
+	if((tuple = dict_find(&iter, CANCEL)))
+	{
+		int card;
+		PhoneAsset* asset = find_transfer(tuple->value->int32, &card);
+		if(asset)
+			asset->cancelled = 1;
+	}
+
+	if((tuple = dict_find(&iter, CACHED)))
+	{
+		int32_t card = tuple->value->int32;
+		Tuple* hash = dict_find(&iter, HASH);
+		if(card >= 0 && card < phone.total && hash &&
+			(hash->value->uint32 == phone_card_hash(card, 0) || hash->value->uint32 == phone_card_hash(card, 1)))
+		{
+			PhoneCard* state = &phone.cards[card];
+			state->text_done = 1;
+			state->icon_asked = 1;
+			state->icon.done = 1;
+			state->image.done = 1;
+		}
+	}
+
+	if((tuple = dict_find(&iter, ICON_CARD)))
+	{
+		int32_t card = tuple->value->int32;
+		Tuple* needed = dict_find(&iter, ICON_NEEDED);
+		if(card >= 0 && card < phone.total && needed)
+		{
+			PhoneAsset* icon = &phone.cards[card].icon;
+			phone.cards[card].icon_asked = 1;
+			if(needed->value->int32 && (icon->done || first_needed(icon) < 0) && !icon->waiting)
+				reset_asset(icon, 48, 1);
+			else if(!needed->value->int32)
+				icon->done = 1;
+		}
+	}
+
+	phone_pump();
+}
+
+static void phone_setup(PhoneOptions options)
+{
+	memset(&phone, 0, sizeof(phone));
+	phone.options = options;
+	phone.total = 8;
+	phone.direction = 1;
+	phone.next_transfer = 1;
+	if(corpus_count == 0)
+		corpus_generate();
+	icons_generate();
+	for(int card = 0; card < PHONE_CARDS; card++)
+		reset_phone_card(card);
+	host_set_outbox_hook(phone_received, NULL);
+}
+
+//single messages for calling the handler directly
+static uint16_t phone_text_message(uint8_t* out, int card)
+{
+	uint16_t size = text_message(card);
+	memcpy(out, message, size);
+	return size;
+}
+
+static uint16_t phone_last_chunk_message(uint8_t* out, int card, int command) //the chunk that ends the background, untracked
+{
+	uint8_t data[4096];
+	int length;
+	int count = (command == UPDATEIMAGE_RLE)? 144 : phone.image_rows;
+	int first = 144 - count;
+	if(command == UPDATEIMAGE_RLE)
+	{
+		//as many trailing rows as pack into one message
+		int budget = phone.inbox - phone_chunk_overhead(0, 0);
+		while(rle_rows(phone_row(card, 1, first), 144 - first, IMAGE_ROW_BYTES, budget, data, &length) < 144 - first)
+			first++;
+	}
+	else
+	{
+		for(int row = first; row < 144; row++)
+			memcpy(&data[(row - first) * IMAGE_ROW_BYTES], phone_row(card, 1, row), IMAGE_ROW_BYTES);
+		length = count * IMAGE_ROW_BYTES;
+	}
+
+	message_begin(command, card);
+	message_int(LINE, first);
+	dict_write_data(&message_iter, BYTES, data, length);
+	uint16_t size = message_end();
+	memcpy(out, message, size);
+	return size;
+}
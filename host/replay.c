@@ -0,0 +1,218 @@
+//record and replay of phone to watch sessions, src/main.c built against the pebble.h stand-in
+//replay feeds a capture through the inbox and the click handlers at the captured times, then checks the screen it ends on
+
+#define main watch_main
+#include "../src/main.c"
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "host.h"
+#include "capture.h"
+#include "phone.c"
+
+#define MAX_CARDS 256
+#define SETTLE_MS 3000 //after the last press, for the transition and the last chunks
+
+static uint64_t wall_ns(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000u + time.tv_nsec;
+}
+
+static int32_t completed_at[MAX_CARDS];
+
+static void check_cards(void) //first time each card has every part
+{
+	for(int slot = 0; slot < CACHE_SIZE; slot++)
+	{
+		int card = notif_ids[slot];
+		if(card >= 0 && card < MAX_CARDS && completed_at[card] < 0 && slot_loaded[slot] == ALL_LOADED)
+			completed_at[card] = host_now();
+	}
+}
+
+//record: the simulated phone streaming cards while someone reads through them
+static int record(const char* path, int cards, uint32_t read_ms)
+{
+	phone_setup(PHONE_DEFAULT);
+	phone.total = cards;
+	if(!capture_start(path))
+		return 1;
+	init();
+	host_render();
+
+	while(!(find_slot(0) >= 0 && slot_loaded[find_slot(0)] == ALL_LOADED) && host_now() < 60000)
+		host_run_for(5);
+	host_click(BUTTON_ID_DOWN); //off the watchface
+	for(int press = 0; press < cards - 1; press++)
+	{
+		host_run_for(read_ms);
+		host_click(BUTTON_ID_DOWN);
+	}
+	host_run_for(SETTLE_MS);
+	capture_finish();
+
+	printf("%s: %u messages, %u B, %u ms\n", path, phone.messages, phone.bytes, host_now());
+	return 0;
+}
+
+//replay
+typedef struct {
+	const CaptureRecord* record;
+	char real_speed;
+	uint64_t started; //wall clock at virtual 0
+} ReplayEvent;
+
+static void replay_event(void* data)
+{
+	ReplayEvent* event = data;
+	const CaptureRecord* record = event->record;
+
+	if(event->real_speed)
+	{
+		uint64_t due = event->started + (uint64_t)record->time * 1000000u;
+		uint64_t now = wall_ns();
+		if(due > now)
+			nanosleep(&(struct timespec){ .tv_sec = (due - now) / 1000000000u, .tv_nsec = (due - now) % 1000000000u }, NULL);
+	}
+
+	if(record->type == CAPTURE_MESSAGE)
+		host_deliver(record->data, record->length);
+	else if(record->type == CAPTURE_BUTTON_DOWN)
+		host_button_down(record->button);
+	else if(record->type == CAPTURE_BUTTON_UP)
+		host_button_up(record->button);
+	check_cards();
+}
+
+static int replay(const char* path, char real_speed)
+{
+	Capture* capture = capture_load(path);
+	if(!capture)
+		return 1;
+
+	for(int card = 0; card < MAX_CARDS; card++)
+		completed_at[card] = -1;
+	host_set_inbox_maximum(capture->inbox_maximum);
+	host_reset_counters();
+	init();
+	host_render();
+
+	//every record is queued up front, so it fires ahead of timers the app sets for the same millisecond, as it did live
+	ReplayEvent* events = calloc(capture->count, sizeof(ReplayEvent));
+	uint64_t started = wall_ns();
+	uint32_t end = 0;
+	uint32_t first_message = 0, last_message = 0;
+	uint32_t messages = 0, bytes = 0;
+	const CaptureRecord* end_record = NULL;
+	for(int i = 0; i < capture->count; i++)
+	{
+		const CaptureRecord* record = &capture->records[i];
+		if(record->type == CAPTURE_END)
+		{
+			end_record = record;
+			end = record->time;
+			continue;
+		}
+		if(record->type == CAPTURE_MESSAGE)
+		{
+			if(messages++ == 0)
+				first_message = record->time;
+			last_message = record->time;
+			bytes += record->length;
+		}
+		events[i] = (ReplayEvent){ .record = record, .real_speed = real_speed, .started = started };
+		host_schedule(record->time, replay_event, &events[i]);
+		if(record->time > end)
+			end = record->time;
+	}
+	host_run_until(end);
+	host_render();
+	double wall_s = (wall_ns() - started) / 1e9;
+	double span_s = (last_message - first_message) / 1000.0;
+
+	printf("%s: %u messages, %u B over %u ms%s\n", path, messages, bytes, end, (real_speed)? ", real speed" : "");
+	printf("  captured rate     %8.1f msgs/s %10.0f B/s\n", (span_s > 0)? messages / span_s : 0, (span_s > 0)? bytes / span_s : 0);
+	printf("  replay rate       %8.1f msgs/s %10.0f B/s  (%.3f s wall)\n", messages / wall_s, bytes / wall_s, wall_s);
+	printf("  inbox overflows   %8u\n", host_counters.messages_dropped);
+	printf("  card complete at ");
+	int shown = 0;
+	for(int card = 0; card < MAX_CARDS; card++)
+	{
+		if(completed_at[card] >= 0)
+			printf("%s%d:%dms", (shown++ % 6)? "  " : "\n    ", card, completed_at[card]);
+	}
+	printf("%s\n", (shown)? "" : "none");
+
+	uint32_t checksum = host_framebuffer_checksum();
+	int result = 0;
+	if(end_record && end_record->length == 4)
+	{
+		uint32_t expected;
+		memcpy(&expected, end_record->data, 4);
+		result = checksum != expected;
+		printf("  framebuffer       %08x, captured %08x, %s\n", checksum, expected, (result)? "DIFFERENT" : "same");
+	}
+	else
+		printf("  framebuffer       %08x\n", checksum);
+
+	free(events);
+	capture_free(capture);
+	return result;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: replay [--fast] [--verbose] capture\n");
+	fprintf(stderr, "       replay --record capture [--cards n] [--read ms] [--inbox bytes] [--images file.pbm...]\n");
+}
+
+int main(int argc, char** argv)
+{
+	const char* record_path = NULL;
+	const char* replay_path = NULL;
+	char real_speed = 1;
+	int cards = 8;
+	uint32_t read_ms = 2000;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			record_path = argv[++i];
+		else if(strcmp(argv[i], "--cards") == 0 && i + 1 < argc)
+			cards = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--read") == 0 && i + 1 < argc)
+			read_ms = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--inbox") == 0 && i + 1 < argc)
+			host_set_inbox_maximum(atoi(argv[++i]));
+		else if(strcmp(argv[i], "--fast") == 0)
+			real_speed = 0;
+		else if(strcmp(argv[i], "--verbose") == 0)
+			host_verbose = 1;
+		else if(strcmp(argv[i], "--images") == 0)
+		{
+			while(i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				if(!corpus_load_pbm(argv[++i]))
+					return 1;
+			}
+		}
+		else if(argv[i][0] != '-' && !replay_path)
+			replay_path = argv[i];
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	if(record_path && cards > 0 && cards <= PHONE_CARDS)
+		return record(record_path, cards, read_ms);
+	if(replay_path && !record_path)
+		return replay(replay_path, real_speed);
+	usage();
+	return 1;
+}
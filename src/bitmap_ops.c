@@ -0,0 +1,85 @@
+#include "bitmap_ops.h"
+
+void bitmap_fill_pattern(GBitmap* bitmap, uint32_t even_word, uint32_t odd_word)
+{
+	int row_words = bitmap->row_size_bytes / 4;
+	uint32_t* word = (uint32_t*)bitmap->addr;
+	
+	for(int row = 0; row < bitmap->bounds.size.h; row++)
+	{
+		uint32_t pattern = (row % 2 == 0)? even_word : odd_word;
+		for(int col = 0; col < row_words; col++)
+			*word++ = pattern;
+	}
+}
+
+void bitmap_clear(GBitmap* bitmap)
+{
+	//one run over the whole buffer, the library's memset already stores words
+	memset(bitmap->addr, 0, bitmap->row_size_bytes * bitmap->bounds.size.h);
+}
+
+void bitmap_invert(GBitmap* bitmap)
+{
+	int words = bitmap->row_size_bytes / 4 * bitmap->bounds.size.h;
+	uint32_t* word = (uint32_t*)bitmap->addr;
+	
+	for(int i = 0; i < words; i++)
+		word[i] = ~word[i];
+}
+
+//packed rows start on any byte, so each word is loaded unaligned and stored aligned, the odd bytes after
+static void copy_row(uint8_t* dest, const uint8_t* src, int row_bytes)
+{
+	uint32_t* word = (uint32_t*)dest;
+	int row_words = row_bytes / 4;
+	
+	for(int col = 0; col < row_words; col++)
+	{
+		uint32_t value;
+		memcpy(&value, src + col * 4, 4);
+		word[col] = value;
+	}
+	for(int col = row_words * 4; col < row_bytes; col++)
+		dest[col] = src[col];
+}
+
+int bitmap_copy_rows(GBitmap* bitmap, int starting_row, const uint8_t* src, int length)
+{
+	int row_bytes = (bitmap->bounds.size.w + 7) / 8;
+	int end_row = starting_row + length / row_bytes;
+	uint8_t* dest = (uint8_t*)bitmap->addr;
+	
+	if(starting_row < 0)
+		return starting_row;
+	if(end_row > bitmap->bounds.size.h)
+		end_row = bitmap->bounds.size.h;
+	
+	for(int row = starting_row; row < end_row; row++)
+	{
+		copy_row(&dest[row * bitmap->row_size_bytes], src, row_bytes);
+		src += row_bytes;
+	}
+	return end_row;
+}
+
+int bitmap_copy_rows_interlaced(GBitmap* bitmap, int starting_row, int step, int fill_rows, const uint8_t* src, int length)
+{
+	int row_bytes = (bitmap->bounds.size.w + 7) / 8;
+	int height = bitmap->bounds.size.h;
+	uint8_t* dest = (uint8_t*)bitmap->addr;
+	int end_row = starting_row;
+	
+	if(starting_row < 0)
+		return starting_row;
+	
+	for(int row = starting_row; row < height && length >= row_bytes; row += step)
+	{
+		for(int fill = row; fill < row + fill_rows && fill < height; fill++)
+			copy_row(&dest[fill * bitmap->row_size_bytes], src, row_bytes);
+		src += row_bytes;
+		length -= row_bytes;
+		end_row = row + 1;
+	}
+	return end_row;
+}
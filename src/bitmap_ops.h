@@ -0,0 +1,22 @@
+#pragma once
+#include "pebble.h"
+
+//1bpp bitmap kernels, working a 32 bit word at a time
+//bitmaps must be word aligned with row_size_bytes a multiple of 4, as the SDK requires
+
+//fill every row with a word pattern, alternating even and odd rows (padding included)
+void bitmap_fill_pattern(GBitmap* bitmap, uint32_t even_word, uint32_t odd_word);
+
+//set every pixel to 0
+void bitmap_clear(GBitmap* bitmap);
+
+//flip every pixel
+void bitmap_invert(GBitmap* bitmap);
+
+//copy tightly packed rows (bounds width / 8 bytes each) into the padded bitmap from starting_row, src can start on any byte
+//returns the row after the last one written
+int bitmap_copy_rows(GBitmap* bitmap, int starting_row, const uint8_t* src, int length);
+
+//copy tightly packed rows into every step-th row from starting_row, repeating each into fill_rows rows
+//returns the row after the last one copied, fill left out
+int bitmap_copy_rows_interlaced(GBitmap* bitmap, int starting_row, int step, int fill_rows, const uint8_t* src, int length);
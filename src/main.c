@@ -1,4 +1,5 @@
 #include "pebble.h"
+#include "bitmap_ops.h"
 
 //image
 #define ROW_SIZE 20 // 144 pixels / 8 bits per byte = 18 bytes. Row bytes must be multiple of 4 = 20 bytes
@@ -7,26 +8,98 @@
 #define ICON_ROW_SIZE 8 // 48 pixels / 8 bits per byte = 6 bytes. Row bytes must be multiple of 4 = 8 bytes
 #define ICON_SIZE 384 // 8 bytes * 48 = 384 bytes.
 //strings
-#define TITLE_SIZE 30
+#define TITLE_SIZE 30 //fixed title and text layout of older phones
 #define TEXT_SIZE 80
+#define MAX_TITLE_LENGTH 60
+#define MAX_TEXT_LENGTH 400 //longer bodies are cut
+#define STRING_ARENA_SIZE 1280 //titles and bodies of every slot
 //cache
-#define CACHE_SIZE 4
+#define CACHE_SIZE 12 //cards whose text and transfers are kept, images only fit for about 4-5 of them
+#define WORKING_SIZE 2 //slots decoded into full bitmaps, enough for the A/B pair
+#define ARENA_SIZE 4992 //packed icons and backgrounds of every slot, 4 raw slots' worth minus the working bitmaps and the icon store, 2-3 average cards
+#define ICON_STORE_SIZE 4 //icons shared between cards, looked up by hash
 //card
 #define MIN_CARD_HEIGHT 54
 #define MAX_CARD_HEIGHT 102
 //message size
-#define ICON_MESSAGE_ROWS 16
-#define IMAGE_MESSAGE_ROWS 4
+#define OUTBOX_SIZE 128 //room for the REPORT stats block
+#define EVICTED_LIST_SIZE 12 //cards one EVICTED message carries
+#define OUTBOX_RETRY_DELAY 500 //ms before a failed send goes again
 //expand size
 #define EXPAND_SIZE 95
 	
 #define TEMP_SIZE 66
+//animation
+#define ANIMATION_DURATION 300
+#define FAST_SCROLL_DURATION 150 //one jump over every press made during a transition
+#define MAX_TRACKS 5
+#define EASE_STEPS 16
+//redraw
+#define REDRAW_INTERVAL 200 //minimum ms between redraws while an upload is still arriving
+//interlaced images, pass 0 sends every 8th row and each later pass halves the gaps
+#define INTERLACE_PASSES 4
+//transfer
+#define TRANSFER_TIMEOUT 1000 //ms without progress before the watch asks for missing rows
+#define TRANSFER_RETRIES 3
+#define PRIORITY_WINDOW 2 //uploads for cards further than this from current are cancelled
+//persist, keys 0 to PERSIST_RECORDS-1 hold card headers, the keys after them the packed rows of any card
+#define PERSIST_SIZE 4096 //all the storage an app gets
+#define PERSIST_RECORDS 4 //cards saved, the most recently viewed complete ones that fit PERSIST_SIZE
+#define PERSIST_ROW_KEYS 15 //shared by every record, as many as PERSIST_SIZE could fill
+//loaded parts of a card
+#define TEXT_LOADED 1
+#define ICON_LOADED 2
+#define IMAGE_LOADED 4
+#define ALL_LOADED 7
+//what handing a working bitmap to another slot may cost
+#define TAKE_IDLE 1 //free, or holding a card with no upload under way
+#define TAKE_ANY 2 //also one holding an unfinished upload, which is packed away as it is
+#define TAKE_SHOWN 3 //also the card sliding out, drawn without its image for the rest of the slide
+//stats, set to 0 to compile the counters out
+#ifndef STATS
+#define STATS 1
+#endif
+//frame trace, set to 1 to record update procs and animation ticks
+#ifndef TRACE
+#define TRACE 0
+#endif
+#define TRACE_SIZE 128 //one swipe between loaded cards records about 100 events
+#ifndef TRACE_CLOCK_US
+#define TRACE_CLOCK_US() (now_ms() * 1000) //the watch only counts ms, the host passes its wall clock
+#endif
+#define TRACE_EVENTS_PER_MESSAGE 16
+//radio
+#define SNIFF_IDLE_TIMEOUT 2000 //ms without traffic or navigation before going back to normal sniff
 	
 enum { //DICTIONARY KEYS
 	 COMMAND,
 	 BYTES,
 	 LINE,
-	 ID
+	 ID,
+	 INBOX_SIZE,
+	 IMAGE_ROWS,
+	 ICON_ROWS,
+	 TOTAL,
+	 EVICTED,
+	 VIEWING,
+	 DIRECTION,
+	 TRANSFER,
+	 SEQUENCE,
+	 ACK,
+	 MISSING,
+	 MISSING_ROWS,
+	 CACHED,
+	 HASH,
+	 STATS_BLOCK,
+	 TRACE_EVENTS,
+	 TRACE_REMAINING,
+	 TITLE_LENGTH,
+	 ICON_CARD,
+	 ICON_NEEDED,
+	 SHIFT,
+	 PASS,
+	 CANCEL,
+	 NEEDED
      };
 
 enum { //command types
@@ -37,37 +110,232 @@ enum { //command types
 	MOVE,
 	VIEW,
 	REPORT,
-	ACTIONS
+	ACTIONS,
+	UPDATEICON_RLE,
+	UPDATEIMAGE_RLE,
+	DUMPTRACE,
+	BATCH,
+	ICONREF,
+	COMMAND_COUNT
 	};
+
+enum { //layers counted in stats
+	BACK_LAYER_A,
+	BACK_LAYER_B,
+	CARD_LAYER_A,
+	CARD_LAYER_B,
+	EXPANDED_LAYER,
+	WATCHFACE_LAYER,
+	LAYER_COUNT,
+	ANIMATION_TICK, //traced only
+	MESSAGE_RECEIVED, //captured inputs, so a session can be lined up with what the phone sent
+	BUTTON_UP,
+	BUTTON_DOWN,
+	BUTTON_LONG_DOWN
+	};
+
+#if STATS
+#define STAT(statement) statement
+#else
+#define STAT(statement)
+#endif
+
+#if TRACE
+#define TRACE_BEGIN(what) trace_event(what, 1)
+#define TRACE_END(what) trace_event(what, 0)
+#define TRACE_INPUT(what, value) trace_event(what, value)
+#else
+#define TRACE_BEGIN(what)
+#define TRACE_END(what)
+#define TRACE_INPUT(what, value)
+#endif
 	
 static Window* window;
 
+//transition, one animation created in init() moves every layer from a shared clock
+typedef struct {
+	Layer* layer;
+	GRect from;
+	GRect to;
+	AnimationCurve curve;
+} TransitionTrack;
+
+static Animation* transition;
+static TransitionTrack transition_tracks[MAX_TRACKS];
+static int transition_track_count = 0;
+static int pending_scroll = 0; //cards to move once the running transition ends, presses made meanwhile add up here
+static char fast_scroll = 0; //next transition is a coalesced jump
+
+//1-(1-t)^2 at t = n/EASE_STEPS, scaled to ANIMATION_NORMALIZED_MAX
+static const uint16_t ease_out_table[EASE_STEPS + 1] = {
+	0, 7936, 15360, 22272, 28672, 34559, 39935, 44799, 49151,
+	52991, 56319, 59135, 61439, 63231, 64511, 65279, 65535
+};
+
+static size_t heap_high_water = 0;
+
+#if STATS
+//counters sent back for REPORT, little endian in this order
+typedef struct __attribute__((packed)) {
+	uint16_t received[COMMAND_COUNT]; //messages per command type
+	uint32_t handler_ms[COMMAND_COUNT]; //time spent handling each command type
+	uint32_t bytes_received;
+	uint16_t dropped;
+	uint16_t dropped_reasons; //AppMessageResult bits seen
+	uint16_t failed;
+	uint16_t failed_reasons;
+	uint16_t redraws[LAYER_COUNT];
+	uint16_t animations;
+	uint16_t heap_used;
+	uint16_t heap_free;
+	uint16_t heap_high_water;
+	uint32_t sniff_time[2];
+} Stats;
+
+static Stats stats;
+static char report_pending = 0;
+#endif
+
+#if TRACE
+//ring buffer of update proc and animation tick entry/exit times
+typedef struct __attribute__((packed)) {
+	uint32_t time; //us, wraps after 71 minutes
+	uint8_t what; //layer enum, ANIMATION_TICK or an input
+	uint8_t begin; //1 on entry, 0 on exit, the command for MESSAGE_RECEIVED
+} TraceEvent;
+
+static TraceEvent trace_events[TRACE_SIZE];
+static int trace_head = 0; //next event written
+static int trace_count = 0;
+static int trace_dump_remaining = 0; //recording stops while a dump is going out
+#endif
+
 //background
 static Layer* back_layer_A;
 static Layer* back_layer_B;
-static PropertyAnimation* back_animation_old = NULL;
-static PropertyAnimation* back_animation_new = NULL;
-static GBitmap back_bitmaps[CACHE_SIZE];
-static uint8_t back_image_data[CACHE_SIZE][IMAGE_SIZE];
+static GBitmap back_bitmaps[WORKING_SIZE];
+static uint8_t back_image_data[WORKING_SIZE][IMAGE_SIZE] __attribute__((aligned(4)));
 
 //card
 static Layer* card_layer_A;
 static Layer* card_layer_B;
-static PropertyAnimation* card_animation_old = NULL;
-static PropertyAnimation* card_animation_new = NULL;
-static GBitmap icon_bitmaps[CACHE_SIZE];
-static uint8_t icon_image_data[CACHE_SIZE][ICON_SIZE];
+static GBitmap icon_bitmaps[WORKING_SIZE];
+static uint8_t icon_image_data[WORKING_SIZE][ICON_SIZE] __attribute__((aligned(4)));
+
+//working bitmaps, the only slots held decoded
+static int working_slots[WORKING_SIZE]; //slot decoded into each working bitmap, -1 when free
+static char working_changed[WORKING_SIZE]; //written since it was decoded, pack again before reuse
+
+//staging, an asset on screen is assembled in the other working bitmap and swapped in once complete
+static GBitmap staging_back_bitmap;
+static GBitmap staging_icon_bitmap; //same data, icon geometry
+static int staging_working = -1; //working bitmap lent to staging, -1 when free
+static int staging_slot = -1; //-1 when free
+static char staging_image;
+
+//arena, packbits rows of every slot back to back, icon rows then image rows
+static uint8_t arena[ARENA_SIZE];
+static uint16_t arena_used = 0;
+static uint16_t slot_offsets[CACHE_SIZE];
+static uint16_t slot_icon_lengths[CACHE_SIZE];
+static uint16_t slot_lengths[CACHE_SIZE]; //0 for a blank card
 
 //expanded
 static Layer* expanded_layer;
-static PropertyAnimation* expanded_animation = NULL;
 
-//strings
-static char title_strings[CACHE_SIZE][TITLE_SIZE];
-static char text_strings[CACHE_SIZE][TEXT_SIZE];
+//strings, title and text of every slot back to back, each NUL terminated
+static char strings[STRING_ARENA_SIZE];
+static uint16_t strings_used = 0;
+static uint16_t string_offsets[CACHE_SIZE];
+static uint8_t title_lengths[CACHE_SIZE];
+static uint16_t string_lengths[CACHE_SIZE]; //both strings and terminators, 0 while nothing has arrived
+
+//text measurements, worked out once per text change instead of every frame
+typedef struct {
+	int16_t title_height;
+	int16_t body_height;
+	int16_t card_height; //clamped between MIN_CARD_HEIGHT and MAX_CARD_HEIGHT
+	int16_t image_pos; //parallax offset of the background
+} CardLayout;
+
+static CardLayout card_layouts[CACHE_SIZE];
 
 //ids
-static int notif_ids[CACHE_SIZE];
+static int notif_ids[CACHE_SIZE]; //card held by each slot, -1 when empty
+static uint32_t slot_viewed[CACHE_SIZE]; //when each slot was last viewed, for eviction
+static uint32_t view_clock = 0;
+static uint8_t slot_loaded[CACHE_SIZE]; //TEXT_LOADED, ICON_LOADED and IMAGE_LOADED bits
+static uint32_t slot_hashes[CACHE_SIZE];
+static int persist_cards[PERSIST_RECORDS]; //card saved in each record, -1 when free
+static uint16_t persist_row_keys[PERSIST_RECORDS]; //row keys each record holds, one bit each
+static int persist_sizes[PERSIST_RECORDS]; //bytes each record stores, header and rows
+
+//icon store, one copy of an icon for every card showing it
+static GBitmap icon_store_bitmaps[ICON_STORE_SIZE];
+static uint8_t icon_store_data[ICON_STORE_SIZE][ICON_SIZE] __attribute__((aligned(4)));
+static uint32_t icon_store_hashes[ICON_STORE_SIZE]; //hash the phone gave the icon
+static char icon_store_ready[ICON_STORE_SIZE]; //every row has arrived
+static uint32_t icon_store_used[ICON_STORE_SIZE]; //view_clock when last referenced, 0 when empty
+static int slot_icons[CACHE_SIZE]; //icon store entry of each slot, -1 when the card owns its icon
+
+//persisted card, its packed rows from the arena are split over the row keys in row_keys, lowest first
+typedef struct {
+	int32_t card;
+	uint32_t hash;
+	uint16_t icon_length;
+	uint16_t length;
+	uint32_t icon_hash; //icon store hash, 0 when the card owns its icon
+	uint16_t string_length; //title and text follow the header in the same key
+	uint16_t row_keys; //bit n for key PERSIST_RECORDS + n
+	uint8_t title_length;
+} PersistedCard;
+
+//batch record, BYTES of a BATCH message holds these back to back, each followed by its data
+typedef struct __attribute__((packed)) {
+	uint8_t command; //CLEAR, UPDATETEXT or one of the icon and image updates
+	uint8_t line; //starting row, or the title length for UPDATETEXT
+	uint16_t length; //bytes of data after the record
+	int32_t card;
+	int32_t transfer; //-1 for an untracked record
+	int32_t sequence;
+} BatchRecord;
+
+//outbox, what the phone still has to be told, each message is written from it when the previous send is done
+static char outbox_busy = 0;
+static AppTimer* outbox_retry_timer = NULL;
+static char hello_pending = 0;
+static char viewing_pending = 0;
+static int32_t evicted_cards[EVICTED_LIST_SIZE]; //evicted since the last EVICTED went out
+static int evicted_count = 0;
+static uint16_t cached_pending = 0; //one bit per slot
+static uint16_t icon_status_pending = 0;
+static uint16_t icon_status_needed = 0;
+static uint32_t icon_status_hashes[CACHE_SIZE];
+
+//redraws held back while uploads stream in, one bit per slot
+static AppTimer* redraw_timer = NULL;
+static uint16_t back_redraw_pending = 0;
+static uint16_t card_redraw_pending = 0;
+
+//transfers, one per slot for the icon [0] and the image [1]
+typedef struct {
+	int32_t id; //-1 when the upload is not tracked
+	int32_t expected_sequence;
+	uint8_t retries;
+	char cancelled; //too far from current, chunks are turned away
+	char status_pending; //ack and nack not sent yet
+	char cancel_pending;
+	uint8_t rows[144/8]; //received rows, one bit each
+} Transfer;
+
+static Transfer transfers[CACHE_SIZE][2];
+static AppTimer* transfer_timer = NULL;
+
+//radio, reduced sniff only while something is being sent or received
+static SniffInterval sniff_interval = SNIFF_INTERVAL_NORMAL;
+static AppTimer* sniff_timer = NULL;
+static uint32_t sniff_changed_at = 0;
+static uint32_t sniff_time[2] = {0, 0}; //ms spent in SNIFF_INTERVAL_NORMAL and SNIFF_INTERVAL_REDUCED
 
 //watchface
 static Layer* watchface_layer;
@@ -75,25 +343,109 @@ static Layer* watchface_layer;
 //selection
 static int current = 0;
 static int previous = 1;
-static int total_cards = 22;
+static int total_cards = 1;
 static char watchface_visible = 1;
 static char expanded_visible = 0;
 static char long_press_down = 0;
+static char layer_flip = 0; //swaps the A/B pair after a jump or renumbering that kept current's parity from alternating
+
+//message size, worked out from the real inbox in init()
+static uint32_t inbox_size;
+static int image_message_rows;
+static int icon_message_rows;
+
+uint32_t now_ms()
+{
+	time_t seconds;
+	uint16_t milliseconds;
+	time_ms(&seconds, &milliseconds);
+	return seconds * 1000 + milliseconds;
+}
+
+void set_sniff_interval(SniffInterval interval)
+{
+	uint32_t now = now_ms();
+	sniff_time[sniff_interval == SNIFF_INTERVAL_REDUCED] += now - sniff_changed_at;
+	sniff_changed_at = now;
+	
+	if(interval != sniff_interval)
+	{
+		sniff_interval = interval;
+		app_comm_set_sniff_interval(interval);
+	}
+}
+
+void sample_heap() //highest heap use seen as message handlers, timers and transitions run, a peak in between is missed
+{
+	size_t used = heap_bytes_used();
+	if(used > heap_high_water)
+		heap_high_water = used;
+}
+
+void sniff_idle(void* data)
+{
+	sample_heap();
+	sniff_timer = NULL;
+	set_sniff_interval(SNIFF_INTERVAL_NORMAL);
+}
+
+void keep_radio_awake() //reduced sniff until SNIFF_IDLE_TIMEOUT passes without activity
+{
+	if(sniff_interval != SNIFF_INTERVAL_REDUCED)
+		set_sniff_interval(SNIFF_INTERVAL_REDUCED);
+	
+	if(sniff_timer)
+		app_timer_reschedule(sniff_timer, SNIFF_IDLE_TIMEOUT);
+	else
+		sniff_timer = app_timer_register(SNIFF_IDLE_TIMEOUT, sniff_idle, NULL);
+}
+
+#if TRACE
+void trace_event(uint8_t what, uint8_t begin)
+{
+	if(trace_dump_remaining > 0)
+		return;
+	
+	trace_events[trace_head] = (TraceEvent){ .time = TRACE_CLOCK_US(), .what = what, .begin = begin };
+	trace_head = (trace_head + 1) % TRACE_SIZE;
+	if(trace_count < TRACE_SIZE)
+		trace_count++;
+}
+#endif
+
+int find_slot(int card) //slot holding card, -1 if not cached
+{
+	//empty slots hold -1 too
+	if(card < 0)
+		return -1;
+	
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		if(notif_ids[i] == card)
+			return i;
+	}
+	return -1;
+}
+
+char current_on_A() //current is drawn by the A layers
+{
+	return (current + layer_flip) % 2 == 0;
+}
 
 void reposition_new() //reposition current before animation
 {
-	GRect card_frame = layer_get_frame((current%2==0)?card_layer_A:card_layer_B);
+	GRect card_frame = layer_get_frame((current_on_A())?card_layer_A:card_layer_B);
 	card_frame.origin.y = 168;
-	layer_set_frame((current%2==0)?card_layer_A:card_layer_B, card_frame);
-	layer_set_frame((current%2==0)?back_layer_A:back_layer_B, GRect(0,144,144,144));
+	layer_set_frame((current_on_A())?card_layer_A:card_layer_B, card_frame);
+	layer_set_frame((current_on_A())?back_layer_A:back_layer_B, GRect(0,144,144,144));
 }
 
 void reposition_old() //reposition previous before animation
 {
-	GRect card_frame = layer_get_frame((current%2==1)?card_layer_A:card_layer_B);
+	GRect card_frame = layer_get_frame((!current_on_A())?card_layer_A:card_layer_B);
 	card_frame.origin.y = 168 - card_frame.size.h;
-	layer_set_frame((current%2==1)?card_layer_A:card_layer_B, card_frame);
-	layer_set_frame((current%2==1)?back_layer_A:back_layer_B, GRect(0,0,144,144));
+	layer_set_frame((!current_on_A())?card_layer_A:card_layer_B, card_frame);
+	layer_set_frame((!current_on_A())?back_layer_A:back_layer_B, GRect(0,0,144,144));
 }
 
 void reposition_current() //reposition current on resize
@@ -106,27 +458,26 @@ void reposition_current() //reposition current on resize
 		card_frame.origin.y = 168;
 		layer_set_frame(card_layer_B, card_frame);
 		
-		card_frame = layer_get_frame((current%2==0)?card_layer_A:card_layer_B);
+		card_frame = layer_get_frame((current_on_A())?card_layer_A:card_layer_B);
 		card_frame.origin.y = 168 - card_frame.size.h;
-		layer_set_frame((current%2==0)?card_layer_A:card_layer_B, card_frame);
-		layer_set_frame((current%2==0)?back_layer_A:back_layer_B, GRect(0,0,144,144));
-		layer_set_frame((current%2==0)?back_layer_B:back_layer_A, GRect(0,144,144,144));
+		layer_set_frame((current_on_A())?card_layer_A:card_layer_B, card_frame);
+		layer_set_frame((current_on_A())?back_layer_A:back_layer_B, GRect(0,0,144,144));
+		layer_set_frame((current_on_A())?back_layer_B:back_layer_A, GRect(0,144,144,144));
 	}
 }
 
 
 
+int layout_height(int card) //card layer height, the smallest for a card that is not cached
+{
+	int slot = find_slot(card);
+	return (slot >= 0)? card_layouts[slot].card_height : MIN_CARD_HEIGHT;
+}
+
 void resize_layers()
 {
-	int current_height = MIN_CARD_HEIGHT + 4 + graphics_text_layout_get_content_size(text_strings[current%CACHE_SIZE],
-																				 fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),GRect(0,0,142,168),GTextOverflowModeWordWrap, GTextAlignmentLeft).h;
-	int previous_height = MIN_CARD_HEIGHT + 4 + graphics_text_layout_get_content_size(text_strings[previous%CACHE_SIZE],
-																				  fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),GRect(0,0,142,168),GTextOverflowModeWordWrap, GTextAlignmentLeft).h;
-	if(current_height > MAX_CARD_HEIGHT)
-		current_height = MAX_CARD_HEIGHT;
-	
-	if(previous_height > MAX_CARD_HEIGHT)
-		previous_height = MAX_CARD_HEIGHT;
+	int current_height = layout_height(current);
+	int previous_height = layout_height(previous);
 	
 	int back_A_pos = layer_get_frame(back_layer_A).origin.y;
 	int back_B_pos = layer_get_frame(back_layer_B).origin.y;
@@ -134,7 +485,7 @@ void resize_layers()
 	int card_B_pos = layer_get_frame(card_layer_B).origin.y;
 	
 	
-	if(current % 2 == 0)//if even
+	if(current_on_A())
 	{
 		layer_set_frame(back_layer_A, GRect(0,back_A_pos,144,144));				//0
 		layer_set_frame(back_layer_B, GRect(0,back_B_pos,144,144));				//144
@@ -152,237 +503,1664 @@ void resize_layers()
 	if(watchface_visible)
 	{
 		layer_set_frame(watchface_layer, GRect(0,0,144,168));
-		layer_set_frame(card_layer_A, GRect(0,168-MIN_CARD_HEIGHT,144,current_height));
+		layer_set_frame((current_on_A())?card_layer_A:card_layer_B, GRect(0,168-MIN_CARD_HEIGHT,144,current_height));
 	}
 	else
 		layer_set_frame(watchface_layer, GRect(0,-168,144,168));
 }
 
 
-void blank_image_data(int image_number){
-	//for each row
-	for(int row = 0; row < 144; row++){
-		//for each byte
-		for(int col = 0; col < ROW_SIZE; col++){
-			//pointer to current byte, easier than typing out this string every time
-			uint8_t* current_byte = &back_image_data[image_number][row * ROW_SIZE + col]; 
-			*current_byte = 0;
-			
-			//for each bit
-			for(int bit = 0; bit < 8; bit++){
-				//add 1 or 0 (in checkerboard pattern)
-				*current_byte += ((row % 2) + (col * 8 + bit)) % 2; 
-
-				//if not last bit
-				if(bit != 7)
-					*current_byte <<= 1;//shift bits
-			}
-		}
-	}
+void blank_working(int working){
+	//checkerboard, 0x55 on even rows and 0xAA on odd rows
+	bitmap_fill_pattern(&back_bitmaps[working], 0x55555555, 0xAAAAAAAA);
+	bitmap_clear(&icon_bitmaps[working]);
 }
 
-void blank_icon_data(int image_number){
-	//for each row
-	for(int row = 0; row < 48; row++){
-		//for each byte
-		for(int col = 0; col < ICON_ROW_SIZE; col++){
-			//pointer to current byte, easier than typing out this string every time
-			uint8_t* current_byte = &icon_image_data[image_number][row * ICON_ROW_SIZE + col]; 
-			*current_byte = 0;
-			
-			//for each bit
-			//for(int bit = 0; bit < 8; bit++){
-				//add 1 or 0 (in checkerboard pattern)
-			//	*current_byte += ((row % 2) + (col * 8 + bit)) % 2; 
-
-			//	//if not last bit
-			//	if(bit != 7)
-			//		*current_byte <<= 1;//shift bits
-			//}
-		}
+int working_for(int slot) //working bitmap holding slot, -1 if it is only packed
+{
+	for(int i=0; i<WORKING_SIZE; i++)
+	{
+		if(working_slots[i] == slot)
+			return i;
 	}
+	return -1;
 }
 
-void reset_card(int card_no)
+void free_arena(int slot) //drop the packed rows of slot, closing the gap
 {
-	blank_image_data(card_no);
-	blank_icon_data(card_no);
+	if(slot_lengths[slot] == 0)
+		return;
+	
+	uint16_t offset = slot_offsets[slot];
+	uint16_t length = slot_lengths[slot];
+	memmove(&arena[offset], &arena[offset + length], arena_used - offset - length);
+	arena_used -= length;
 	
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		if(slot_lengths[i] > 0 && slot_offsets[i] > offset)
+			slot_offsets[i] -= length;
+	}
+	slot_lengths[slot] = 0;
+	slot_icon_lengths[slot] = 0;
+}
 
-		strcpy(title_strings[card_no], "Loading");
-		strcpy(text_strings[card_no], "");	
+char* slot_title(int slot)
+{
+	if(string_lengths[slot] == 0)
+		return "Loading";
+	return &strings[string_offsets[slot]];
 }
 
-void in_received_handler(DictionaryIterator *iter, void *context) {
+char* slot_text(int slot)
+{
+	if(string_lengths[slot] == 0)
+		return "";
+	return &strings[string_offsets[slot] + title_lengths[slot] + 1];
+}
 
-	//vibes_short_pulse();
+int padded_length(char* string, int max_length) //length of a string padded with NULs to a fixed size
+{
+	char* end = memchr(string, '\0', max_length);
+	return (end)? end - string : max_length;
+}
+
+void free_strings(int slot) //drop the strings of slot, closing the gap
+{
+	if(string_lengths[slot] == 0)
+		return;
 	
+	uint16_t offset = string_offsets[slot];
+	uint16_t length = string_lengths[slot];
+	memmove(&strings[offset], &strings[offset + length], strings_used - offset - length);
+	strings_used -= length;
 	
-	Tuple *tuple_pointer = dict_find(iter,ID);
-	int id = tuple_pointer->value->int32;
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		if(string_lengths[i] > 0 && string_offsets[i] > offset)
+			string_offsets[i] -= length;
+	}
+	string_lengths[slot] = 0;
+	title_lengths[slot] = 0;
+}
+
+void layout_card(int card_no) //measure text once, read by all draw and resize paths
+{
+	CardLayout* layout = &card_layouts[card_no];
 	
-	tuple_pointer = NULL;
+	layout->title_height = graphics_text_layout_get_content_size(slot_title(card_no),fonts_get_system_font(FONT_KEY_GOTHIC_18),GRect(0,0,142-54,168),GTextOverflowModeWordWrap, GTextAlignmentLeft).h;
+	layout->body_height = graphics_text_layout_get_content_size(slot_text(card_no),fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),GRect(0,0,142,168),GTextOverflowModeWordWrap, GTextAlignmentLeft).h;
 	
-	tuple_pointer = dict_find(iter, COMMAND);
-	if(id < 4)
+	layout->card_height = MIN_CARD_HEIGHT + 4 + layout->body_height;
+	if(layout->card_height > MAX_CARD_HEIGHT)
+		layout->card_height = MAX_CARD_HEIGHT;
+	
+	layout->image_pos = 0-(layout->card_height / 4);
+}
+
+void reset_transfer(Transfer* transfer)
+{
+	transfer->id = -1;
+	transfer->expected_sequence = 0;
+	transfer->retries = 0;
+	transfer->cancelled = 0;
+	transfer->status_pending = 0;
+	transfer->cancel_pending = 0;
+	memset(transfer->rows, 0, sizeof(transfer->rows));
+}
+
+int persist_record(int card) //record holding card, -1 if it is not saved
+{
+	for(int i=0; i<PERSIST_RECORDS; i++)
 	{
-	if(tuple_pointer)
+		if(card >= 0 && persist_cards[i] == card)
+			return i;
+	}
+	return -1;
+}
+
+void forget_record(int record) //delete a saved card, its header and its rows
+{
+	if(persist_exists(record))
+		persist_delete(record);
+	for(int n=0; n<PERSIST_ROW_KEYS; n++)
 	{
-		if(tuple_pointer->value->int8 == CLEAR)
+		if(persist_row_keys[record] & (1 << n))
+			persist_delete(PERSIST_RECORDS + n);
+	}
+	persist_cards[record] = -1;
+	persist_row_keys[record] = 0;
+	persist_sizes[record] = 0;
+}
+
+void forget_card(int card) //delete the saved copy of card
+{
+	int record = persist_record(card);
+	if(record >= 0)
+		forget_record(record);
+}
+
+uint16_t persist_keys_taken() //row keys held by any record
+{
+	uint16_t taken = 0;
+	for(int i=0; i<PERSIST_RECORDS; i++)
+		taken |= persist_row_keys[i];
+	return taken;
+}
+
+void reset_card(int card_no)
+{
+	reset_transfer(&transfers[card_no][0]);
+	reset_transfer(&transfers[card_no][1]);
+	slot_loaded[card_no] = 0;
+	cached_pending &= ~(1 << card_no);
+	icon_status_pending &= ~(1 << card_no);
+	
+	//whatever was saved for this card is no longer what it holds
+	forget_card(notif_ids[card_no]);
+
+	free_arena(card_no);
+	int working = working_for(card_no);
+	if(working >= 0)
+	{
+		blank_working(working);
+		working_changed[working] = 0;
+	}
+	
+	if(staging_slot == card_no)
+	{
+		staging_slot = -1;
+		staging_working = -1;
+	}
+	slot_icons[card_no] = -1;
+	
+	free_strings(card_no);
+	layout_card(card_no);
+}
+
+int missing_rows(Transfer* transfer, int total_rows, int* first_missing) //length of the first run of missing rows
+{
+	int count = 0;
+	*first_missing = -1;
+	
+	for(int row = 0; row < total_rows; row++)
+	{
+		if(transfer->rows[row/8] & (1 << (row%8)))
 		{
-				reset_card(id);
+			if(count > 0)
+				break;
 		}
-		else if(tuple_pointer->value->int8 == UPDATETEXT)
+		else
 		{
-			tuple_pointer = NULL;
-			tuple_pointer = dict_find(iter, BYTES);
-			if(tuple_pointer)
-			{				
-				uint8_t* bytes = tuple_pointer->value->data;
-				
-				//char string[21];
-				for(int i=0;i<TITLE_SIZE;i++){
-					title_strings[id][i] = bytes[i];
-				}
-				for(int i=0; i<TEXT_SIZE;i++)
-				{
-					text_strings[id][i] = bytes[TITLE_SIZE+i];
-				}
-				title_strings[id][TITLE_SIZE-1] = '\0';
-				text_strings[id][TEXT_SIZE-1] = '\0';
-				
-				resize_layers();
-				if(current == id)
-					reposition_current();
-				layer_mark_dirty(card_layer_A);
-				layer_mark_dirty(card_layer_B);
+			if(count == 0)
+				*first_missing = row;
+			count++;
+		}
+	}
+	return count;
+}
+
+int received_rows(Transfer* transfer, int total_rows)
+{
+	int count = 0;
+	for(int row = 0; row < total_rows; row++)
+	{
+		if(transfer->rows[row/8] & (1 << (row%8)))
+			count++;
+	}
+	return count;
+}
+
+Transfer* transfer_with_id(int32_t id)
+{
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		for(int image=0; image<2; image++)
+		{
+			if(id >= 0 && transfers[i][image].id == id)
+				return &transfers[i][image];
+		}
+	}
+	return NULL;
+}
+
+int card_distance(int card) //cards between card and current
+{
+	return (card > current)? card - current : current - card;
+}
+
+void add_evicted(int32_t card) //the phone has to resend card if it is wanted again
+{
+	for(int i=0; i<evicted_count; i++)
+	{
+		if(evicted_cards[i] == card)
+			return;
+	}
+	
+	//full, the one furthest from current goes, the NEEDED bits of VIEWING bring it back if it is viewed
+	if(evicted_count == EVICTED_LIST_SIZE)
+	{
+		int furthest = 0;
+		for(int i=1; i<evicted_count; i++)
+		{
+			if(card_distance(evicted_cards[i]) > card_distance(evicted_cards[furthest]))
+				furthest = i;
+		}
+		evicted_cards[furthest] = evicted_cards[--evicted_count];
+	}
+	evicted_cards[evicted_count++] = card;
+}
+
+void outbox_failed(DictionaryIterator *failed) //whatever the failed message told the phone is pending again
+{
+	Tuple *tuple_pointer;
+	
+	if(dict_find(failed, INBOX_SIZE))
+		hello_pending = 1;
+	if(dict_find(failed, VIEWING))
+		viewing_pending = 1;
+	
+	tuple_pointer = dict_find(failed, EVICTED);
+	for(int i=0; tuple_pointer && i + 4 <= tuple_pointer->length; i += 4)
+	{
+		int32_t card;
+		memcpy(&card, tuple_pointer->value->data + i, 4);
+		add_evicted(card);
+	}
+	
+	//a transfer or slot reset since then has nothing left to tell
+	tuple_pointer = dict_find(failed, TRANSFER);
+	Transfer* transfer = (tuple_pointer)? transfer_with_id(tuple_pointer->value->int32) : NULL;
+	if(transfer)
+		transfer->status_pending = 1;
+	
+	tuple_pointer = dict_find(failed, CANCEL);
+	transfer = (tuple_pointer)? transfer_with_id(tuple_pointer->value->int32) : NULL;
+	if(transfer && transfer->cancelled)
+		transfer->cancel_pending = 1;
+	
+	tuple_pointer = dict_find(failed, CACHED);
+	int slot = (tuple_pointer)? find_slot(tuple_pointer->value->int32) : -1;
+	if(slot >= 0 && slot_loaded[slot] == ALL_LOADED)
+		cached_pending |= 1 << slot;
+	
+	tuple_pointer = dict_find(failed, ICON_CARD);
+	slot = (tuple_pointer)? find_slot(tuple_pointer->value->int32) : -1;
+	if(slot >= 0)
+		icon_status_pending |= 1 << slot;
+	
+#if STATS
+	if(dict_find(failed, STATS_BLOCK))
+		report_pending = 1;
+#endif
+#if TRACE
+	//the same events go again, recording is still stopped unless it was the last of the dump
+	tuple_pointer = dict_find(failed, TRACE_EVENTS);
+	if(tuple_pointer && trace_count > 0)
+		trace_dump_remaining += tuple_pointer->length / sizeof(TraceEvent);
+#endif
+}
+
+char send_outbox() //returns 1 once the message is on its way, a refused one stays pending
+{
+	if(app_message_outbox_send() != APP_MSG_OK)
+		return 0;
+	keep_radio_awake();
+	outbox_busy = 1;
+	return 1;
+}
+
+void write_int(DictionaryIterator *iter, uint8_t key, int32_t value)
+{
+	Tuplet tuplet = TupletInteger(key, value);
+	dict_write_tuplet(iter, &tuplet);
+}
+
+Transfer* pending_transfer(char cancel, int* total_rows) //first transfer with a status or cancel to send
+{
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		for(int image=0; image<2; image++)
+		{
+			Transfer* transfer = &transfers[i][image];
+			if(transfer->id >= 0 && ((cancel)? transfer->cancel_pending : transfer->status_pending))
+			{
+				*total_rows = image? 144 : 48;
+				return transfer;
 			}
+		}
+	}
+	return NULL;
+}
+
+int pending_slot(uint16_t pending) //lowest slot with its bit set, -1 when none is
+{
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		if(pending & (1 << i))
+			return i;
+	}
+	return -1;
+}
+
+void send_next_message()
+{
+	if(outbox_busy)
+		return;
+	
+	int total_rows;
+	Transfer* cancel = pending_transfer(1, &total_rows);
+	Transfer* status = pending_transfer(0, &total_rows);
+	char waiting = hello_pending || viewing_pending || evicted_count > 0 || cancel || status || cached_pending || icon_status_pending;
+	STAT(waiting |= report_pending);
+#if TRACE
+	waiting |= trace_dump_remaining > 0;
+#endif
+	if(!waiting)
+		return;
+	
+	DictionaryIterator *iter;
+	if(app_message_outbox_begin(&iter) != APP_MSG_OK)
+		return;
+	
+	//handshake, tell the phone how much it can send at once
+	if(hello_pending)
+	{
+		write_int(iter, 1, 0);
+		write_int(iter, INBOX_SIZE, (int32_t)inbox_size);
+		write_int(iter, IMAGE_ROWS, (int32_t)image_message_rows);
+		write_int(iter, ICON_ROWS, (int32_t)icon_message_rows);
+		if(send_outbox())
+			hello_pending = 0;
+		return;
+	}
+	
+#if STATS
+	//a requested report goes out ahead of the rest
+	if(report_pending)
+	{
+		stats.heap_used = heap_bytes_used();
+		stats.heap_free = heap_bytes_free();
+		sample_heap();
+		stats.heap_high_water = heap_high_water;
+		stats.sniff_time[0] = sniff_time[0];
+		stats.sniff_time[1] = sniff_time[1];
+		
+		dict_write_data(iter, STATS_BLOCK, (uint8_t*)&stats, sizeof(stats));
+		if(send_outbox())
+			report_pending = 0;
+		return;
+	}
+#endif
+	
+#if TRACE
+	//trace dump, oldest events first
+	if(trace_dump_remaining > 0)
+	{
+		TraceEvent events[TRACE_EVENTS_PER_MESSAGE];
+		int count = (trace_dump_remaining < TRACE_EVENTS_PER_MESSAGE)? trace_dump_remaining : TRACE_EVENTS_PER_MESSAGE;
+		int start = trace_head - trace_dump_remaining + TRACE_SIZE;
+		for(int i=0; i<count; i++)
+			events[i] = trace_events[(start + i) % TRACE_SIZE];
+		
+		dict_write_data(iter, TRACE_EVENTS, (uint8_t*)events, count * sizeof(TraceEvent));
+		write_int(iter, TRACE_REMAINING, (int32_t)(trace_dump_remaining - count));
+		if(send_outbox())
+		{
+			trace_dump_remaining -= count;
 			
+			//start recording afresh once everything is out
+			if(trace_dump_remaining == 0)
+				trace_count = 0;
+		}
+		return;
+	}
+#endif
+	
+	//every card evicted since the last one, as int32s back to back
+	if(evicted_count > 0)
+	{
+		dict_write_data(iter, EVICTED, (uint8_t*)evicted_cards, evicted_count * sizeof(int32_t));
+		if(send_outbox())
+			evicted_count = 0;
+		return;
+	}
+	
+	//stop uploads nobody is waiting for before asking for more
+	if(cancel)
+	{
+		write_int(iter, CANCEL, cancel->id);
+		if(send_outbox())
+			cancel->cancel_pending = 0;
+		return;
+	}
+	
+	//where the user is, what current still lacks goes first
+	if(viewing_pending)
+	{
+		int slot = find_slot(current);
+		int first_missing = 0;
+		if(slot >= 0)
+			missing_rows(&transfers[slot][1], 144, &first_missing);
+		
+		write_int(iter, VIEWING, current);
+		write_int(iter, DIRECTION, (current > previous)? 1 : -1);
+		write_int(iter, NEEDED, (slot >= 0)? ALL_LOADED & ~slot_loaded[slot] : ALL_LOADED);
+		write_int(iter, MISSING, first_missing);
+		if(send_outbox())
+			viewing_pending = 0;
+		return;
+	}
+	
+	//ack what arrived, nack the first missing window, as it stands now
+	if(status)
+	{
+		int first_missing;
+		int count = missing_rows(status, total_rows, &first_missing);
+		write_int(iter, TRANSFER, status->id);
+		write_int(iter, ACK, received_rows(status, total_rows));
+		write_int(iter, MISSING, first_missing);
+		write_int(iter, MISSING_ROWS, count);
+		if(send_outbox())
+			status->status_pending = 0;
+		return;
+	}
+	
+	int slot = pending_slot(icon_status_pending);
+	if(slot >= 0)
+	{
+		write_int(iter, ICON_CARD, notif_ids[slot]);
+		write_int(iter, HASH, icon_status_hashes[slot]);
+		write_int(iter, ICON_NEEDED, (icon_status_needed >> slot) & 1);
+		if(send_outbox())
+			icon_status_pending &= ~(1 << slot);
+		return;
+	}
+	
+	slot = pending_slot(cached_pending);
+	write_int(iter, CACHED, notif_ids[slot]);
+	write_int(iter, HASH, slot_hashes[slot]);
+	if(send_outbox())
+		cached_pending &= ~(1 << slot);
+}
+
+void retry_outbox(void* data)
+{
+	sample_heap();
+	outbox_retry_timer = NULL;
+	outbox_busy = 0;
+	send_next_message();
+}
+
+void retry_outbox_later() //nothing goes out until the timer fires
+{
+	outbox_busy = 1;
+	if(!outbox_retry_timer)
+		outbox_retry_timer = app_timer_register(OUTBOX_RETRY_DELAY, retry_outbox, NULL);
+}
+
+void send_evicted(int32_t card)
+{
+	add_evicted(card);
+	send_next_message();
+}
+
+void view_card(int card) //mark card as just viewed so it is evicted last
+{
+	int slot = find_slot(card);
+	if(slot >= 0)
+		slot_viewed[slot] = ++view_clock;
+}
+
+int distance(int slot) //cards between slot and current
+{
+	return card_distance(notif_ids[slot]);
+}
+
+char evict_before(int a, int b) //slot a goes before slot b: further from current, or as far and viewed longer ago
+{
+	int distance_a = distance(a);
+	int distance_b = distance(b);
+	return distance_a > distance_b || (distance_a == distance_b && slot_viewed[a] < slot_viewed[b]);
+}
+
+int spare_slot(int keep) //lowest empty slot, else the one to evict first, never what is on screen or keep
+{
+	int slot = -1;
+	
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		//never evict what is on screen
+		if(i == keep || (notif_ids[i] >= 0 && (notif_ids[i] == current || notif_ids[i] == previous)))
+			continue;
+		if(slot < 0 || (notif_ids[slot] >= 0 && (notif_ids[i] < 0 || evict_before(i, slot))))
+			slot = i;
+	}
+	return slot;
+}
+
+void evict_slot(int slot)
+{
+	//tell the phone it has to resend this card if it is wanted again
+	if(notif_ids[slot] >= 0)
+		send_evicted(notif_ids[slot]);
+	
+	reset_card(slot);
+	notif_ids[slot] = -1;
+	
+	int working = working_for(slot);
+	if(working >= 0)
+		working_slots[working] = -1;
+}
+
+int load_slot(int card) //slot holding card, evicting the least recently viewed one if needed
+{
+	int slot = find_slot(card);
+	if(slot >= 0)
+		return slot;
+	
+	slot = spare_slot(-1);
+	evict_slot(slot);
+	
+	notif_ids[slot] = card;
+	slot_viewed[slot] = ++view_clock;
+	return slot;
+}
+
+int store_strings(int slot, char* title, int title_length, char* text, int text_length) //copy both strings into the arena once, 0 when even the title does not fit
+{
+	free_strings(slot);
+	
+	if(title_length > MAX_TITLE_LENGTH)
+		title_length = MAX_TITLE_LENGTH;
+	if(text_length > MAX_TEXT_LENGTH)
+		text_length = MAX_TEXT_LENGTH;
+	
+	//make room by evicting the cards furthest from current
+	while(STRING_ARENA_SIZE - strings_used < title_length + text_length + 2)
+	{
+		int victim = -1;
+		for(int i=0; i<CACHE_SIZE; i++)
+		{
+			if(i == slot || string_lengths[i] == 0 || notif_ids[i] == current || notif_ids[i] == previous)
+				continue;
+			if(victim < 0 || evict_before(i, victim))
+				victim = i;
+		}
+		if(victim < 0)
+		{
+			//only visible cards left, cut the body to what fits
+			text_length = STRING_ARENA_SIZE - strings_used - title_length - 2;
+			if(text_length < 0)
+				return 0;
+			break;
+		}
+		evict_slot(victim);
+	}
+	
+	uint16_t offset = strings_used;
+	memcpy(&strings[offset], title, title_length);
+	strings[offset + title_length] = '\0';
+	memcpy(&strings[offset + title_length + 1], text, text_length);
+	strings[offset + title_length + 1 + text_length] = '\0';
+	
+	string_offsets[slot] = offset;
+	title_lengths[slot] = title_length;
+	string_lengths[slot] = title_length + text_length + 2;
+	strings_used += string_lengths[slot];
+	return 1;
+}
+
+int find_icon(uint32_t hash) //icon store entry with hash, -1 if it was never sent
+{
+	for(int i=0; i<ICON_STORE_SIZE; i++)
+	{
+		if(icon_store_used[i] > 0 && icon_store_hashes[i] == hash)
+			return i;
+	}
+	return -1;
+}
+
+int reference_icon(int slot, uint32_t hash) //point slot at the icon with hash, returns 1 when it is already here
+{
+	slot_icons[slot] = -1;
+	
+	int icon = find_icon(hash);
+	if(icon < 0)
+	{
+		//reuse the least recently used icon no card points at
+		for(int i=0; i<ICON_STORE_SIZE; i++)
+		{
+			char referenced = 0;
+			for(int n=0; n<CACHE_SIZE && !referenced; n++)
+				referenced = (slot_icons[n] == i);
+			if(!referenced && (icon < 0 || icon_store_used[i] < icon_store_used[icon]))
+				icon = i;
+		}
+		if(icon < 0)
+			return 0; //all in use, the card keeps its own copy
+		
+		icon_store_hashes[icon] = hash;
+		icon_store_ready[icon] = 0;
+		bitmap_clear(&icon_store_bitmaps[icon]);
+	}
+	
+	slot_icons[slot] = icon;
+	icon_store_used[icon] = ++view_clock;
+	return icon_store_ready[icon];
+}
+
+void send_icon_status(int slot, uint32_t hash, char needed) //have it or need it, the phone only sends the rows when needed
+{
+	icon_status_hashes[slot] = hash;
+	if(needed)
+		icon_status_needed |= 1 << slot;
+	else
+		icon_status_needed &= ~(1 << slot);
+	icon_status_pending |= 1 << slot;
+	send_next_message();
+}
+
+void send_transfer_status(Transfer* transfer) //ack what arrived, nack the first missing window
+{
+	transfer->status_pending = 1;
+	send_next_message();
+}
+
+void send_cancel(Transfer* transfer)
+{
+	transfer->cancel_pending = 1;
+	send_next_message();
+}
+
+Layer* slot_layer(int slot, char image) //layer showing slot, NULL when off screen
+{
+	int card = notif_ids[slot];
+	
+	if(card == current)
+	{
+		if(image)
+			return (current_on_A())?back_layer_A:back_layer_B;
+		return (current_on_A())?card_layer_A:card_layer_B;
+	}
+	
+	//previous is only on screen while it slides out
+	if(card == previous && animation_is_scheduled(transition))
+	{
+		if(image)
+			return (current_on_A())?back_layer_B:back_layer_A;
+		return (current_on_A())?card_layer_B:card_layer_A;
+	}
+	
+	return NULL;
+}
+
+void flush_redraws(void* data)
+{
+	sample_heap();
+	redraw_timer = NULL;
+	
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		Layer* layer;
+		if((back_redraw_pending & (1 << i)) && (layer = slot_layer(i, 1)))
+			layer_mark_dirty(layer);
+		if((card_redraw_pending & (1 << i)) && (layer = slot_layer(i, 0)))
+			layer_mark_dirty(layer);
+	}
+	back_redraw_pending = 0;
+	card_redraw_pending = 0;
+}
+
+void redraw_slot(int slot, char image, char finished) //redraw now when finished, otherwise at most every REDRAW_INTERVAL
+{
+	if(finished)
+	{
+		Layer* layer = slot_layer(slot, image);
+		if(layer)
+			layer_mark_dirty(layer);
+		
+		if(image)
+			back_redraw_pending &= ~(1 << slot);
+		else
+			card_redraw_pending &= ~(1 << slot);
+		return;
+	}
+	
+	if(image)
+		back_redraw_pending |= 1 << slot;
+	else
+		card_redraw_pending |= 1 << slot;
+	
+	if(!redraw_timer)
+		redraw_timer = app_timer_register(REDRAW_INTERVAL, flush_redraws, NULL);
+}
+
+void release_staging() //staged rows go live as they are and the working bitmap they borrowed is free again
+{
+	if(staging_slot < 0)
+		return;
+	
+	int working = working_for(staging_slot);
+	if(working >= 0)
+	{
+		GBitmap* live = (staging_image)? &back_bitmaps[working] : &icon_bitmaps[working];
+		memcpy(live->addr, back_image_data[staging_working], (staging_image)? IMAGE_SIZE : ICON_SIZE);
+		working_changed[working] = 1;
+		redraw_slot(staging_slot, staging_image, 1);
+	}
+	staging_slot = -1;
+	staging_working = -1;
+}
+
+void release_staging_off_screen() //nothing left to hide once the staged asset has left the screen
+{
+	if(staging_slot >= 0 && !slot_layer(staging_slot, staging_image))
+		release_staging();
+}
+
+void release_staging_for(int slot, char image) //the staged asset stopped arriving
+{
+	if(staging_slot == slot && staging_image == image)
+		release_staging();
+}
+
+void release_staging_untracked() //an untracked asset that lost a chunk is never sent again, so it never completes
+{
+	if(staging_slot >= 0 && transfers[staging_slot][(staging_image)? 1 : 0].id < 0)
+		release_staging();
+}
+
+void transfer_timeout(void* data) //nothing arrived for a while, ask again for what is still missing
+{
+	sample_heap();
+	transfer_timer = NULL;
+	char waiting = 0;
+	
+	//nothing arrived for a while, so whatever the untracked upload lost is not coming
+	release_staging_untracked();
+	
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		for(int image=0; image<2; image++)
+		{
+			Transfer* transfer = &transfers[i][image];
+			int total_rows = image? 144 : 48;
+			
+			if(transfer->id < 0 || transfer->cancelled || transfer->retries >= TRANSFER_RETRIES || received_rows(transfer, total_rows) == total_rows)
+				continue;
+			
+			//the last try, whatever is staged goes live
+			if(++transfer->retries == TRANSFER_RETRIES)
+				release_staging_for(i, image);
+			send_transfer_status(transfer);
+			waiting = 1;
+		}
+	}
+	
+	if(waiting)
+		transfer_timer = app_timer_register(TRANSFER_TIMEOUT, transfer_timeout, NULL);
+}
+
+void wait_for_transfers(char progress) //rows that landed push the timeout back, a chunk turned away leaves it where it is
+{
+	keep_radio_awake();
+
+	if(transfer_timer)
+	{
+		if(progress)
+			app_timer_reschedule(transfer_timer, TRANSFER_TIMEOUT);
+	}
+	else
+		transfer_timer = app_timer_register(TRANSFER_TIMEOUT, transfer_timeout, NULL);
+}
+
+void prioritize_transfers() //cancel uploads for cards far from current, resume the ones it came back to
+{
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		if(notif_ids[i] < 0)
+			continue;
+		char distant = notif_ids[i] < current - PRIORITY_WINDOW || notif_ids[i] > current + PRIORITY_WINDOW;
+		
+		for(int image=0; image<2; image++)
+		{
+			Transfer* transfer = &transfers[i][image];
+			int total_rows = image? 144 : 48;
+			
+			//shared icons are wanted by other cards too
+			if(transfer->id < 0 || (!image && slot_icons[i] >= 0) || received_rows(transfer, total_rows) == total_rows)
+				continue;
+			
+			if(distant && !transfer->cancelled)
+			{
+				transfer->cancelled = 1;
+				release_staging_for(i, image);
+				send_cancel(transfer);
+			}
+			else if(!distant && transfer->cancelled)
+			{
+				//the nack asks for the rest from the first missing row
+				transfer->cancelled = 0;
+				transfer->retries = 0;
+				send_transfer_status(transfer);
+			}
+		}
+	}
+}
+
+void send_viewing() //tell the phone where the user is so it can stream the next cards ahead
+{
+	release_staging_off_screen();
+	prioritize_transfers();
+	
+	viewing_pending = 1;
+	send_next_message();
+}
+
+int transfer_cancelled(int32_t transfer_id, int slot, int image) //chunk belongs to a cancelled upload
+{
+	Transfer* transfer = &transfers[slot][image];
+	
+	if(transfer_id < 0 || transfer->id != transfer_id || !transfer->cancelled)
+		return 0;
+	
+	//the phone may have missed the first one
+	send_cancel(transfer);
+	return 1;
+}
+
+int track_chunk(int32_t transfer_id, int32_t sequence, int slot, int image, int starting_row, int last_row, int step) //transfer_id -1 when untracked, returns 1 once the asset is complete
+{
+	Transfer* transfer = &transfers[slot][image];
+	int total_rows = image? 144 : 48;
+	char gap = 0;
+	
+	if(transfer_id < 0)
+		return last_row > starting_row && last_row >= total_rows; //untracked upload, complete when the last row lands
+	
+	//a new transfer id starts a new session for this asset
+	if(transfer->id != transfer_id)
+	{
+		reset_transfer(transfer);
+		transfer->id = transfer_id;
+	}
+	transfer->retries = 0;
+	
+	for(int row = starting_row; row >= 0 && row < last_row && row < total_rows; row += step)
+		transfer->rows[row/8] |= 1 << (row%8);
+	
+	//a jump in sequence means chunks in between were lost
+	if(sequence >= 0)
+	{
+		if(sequence > transfer->expected_sequence)
+			gap = 1;
+		if(sequence >= transfer->expected_sequence)
+			transfer->expected_sequence = sequence + 1;
+	}
+	
+	if(received_rows(transfer, total_rows) == total_rows)
+	{
+		send_transfer_status(transfer);
+		return 1;
+	}
+	
+	if(gap)
+		send_transfer_status(transfer);
+	wait_for_transfers(last_row > starting_row);
+	return 0;
+}
+
+void drop_chunk(int32_t transfer_id, int32_t sequence, int slot, int image) //a chunk with nowhere to go, nack it so its rows come again
+{
+	Transfer* transfer = &transfers[slot][image];
+	
+	//no rows are marked, the status asks for everything from the first missing one
+	track_chunk(transfer_id, sequence, slot, image, 0, 0, 1);
+	if(transfer->id >= 0)
+		send_transfer_status(transfer);
+}
+
+//decode packbits rows straight into a bitmap, starting at starting_row
+//header n >= 0: copy next n+1 bytes, n < 0: repeat next byte 1-n times, -128: no-op
+int unpack_rows(uint8_t* dest, int row_size, int row_bytes, int total_rows, int starting_row, uint8_t* src, int length) //returns the row after the last one written
+{
+	int row = starting_row;
+	int col = 0;
+	int i = 0;
+	
+	//nothing outside the bitmap, callers mark rows from starting_row up to what is returned
+	if(starting_row < 0 || starting_row >= total_rows)
+		return starting_row;
+	
+	while(i < length && row < total_rows)
+	{
+		int8_t header = (int8_t)src[i++];
+		int count;
+		
+		if(header == -128)
+			continue;
+		
+		count = (header >= 0)? header + 1 : 1 - header;
+		
+		for(int n = 0; n < count && i < length && row < total_rows; n++)
+		{
+			//literal runs advance through the source, repeat runs reuse the same byte
+			dest[row * row_size + col] = src[i];
+			if(header >= 0 || n == count - 1)
+				i++;
+			
+			if(++col == row_bytes)
+			{
+				col = 0;
+				row++;
+			}
+		}
+	}
+	return row;
+}
+
+int pack_row(uint8_t* dest, uint8_t* src, int row_bytes) //packbits encode one row, returns encoded length
+{
+	int length = 0;
+	int i = 0;
+	
+	while(i < row_bytes)
+	{
+		//repeat run
+		int run = 1;
+		while(i + run < row_bytes && run < 128 && src[i + run] == src[i])
+			run++;
+		
+		if(run > 1)
+		{
+			dest[length++] = (uint8_t)(1 - run);
+			dest[length++] = src[i];
+			i += run;
+			continue;
+		}
+		
+		//literal run, up to the next repeat
+		int literal = 1;
+		while(i + literal < row_bytes && literal < 128 && !(i + literal + 1 < row_bytes && src[i + literal] == src[i + literal + 1]))
+			literal++;
+		
+		dest[length++] = literal - 1;
+		memcpy(&dest[length], &src[i], literal);
+		length += literal;
+		i += literal;
+	}
+	return length;
+}
+
+int pack_rows(uint8_t* dest, GBitmap* bitmap) //packbits every row of bitmap, dest NULL only measures
+{
+	int row_bytes = bitmap->bounds.size.w / 8;
+	uint8_t row_packed[144/8 * 2]; //worst case packing grows a row, never doubles it
+	int length = 0;
+	
+	for(int row = 0; row < bitmap->bounds.size.h; row++)
+	{
+		int packed = pack_row(row_packed, (uint8_t*)bitmap->addr + row * bitmap->row_size_bytes, row_bytes);
+		if(dest)
+			memcpy(&dest[length], row_packed, packed);
+		length += packed;
+	}
+	return length;
+}
+
+int pack_working(int working) //pack a working bitmap back into the arena, 0 when there is no room
+{
+	int slot = working_slots[working];
+	free_arena(slot);
+	
+	int icon_length = pack_rows(NULL, &icon_bitmaps[working]);
+	int length = icon_length + pack_rows(NULL, &back_bitmaps[working]);
+	
+	//a card held in the other working bitmap does not need its packed copy, it is packed again when it leaves
+	for(int i=0; i<WORKING_SIZE && ARENA_SIZE - arena_used < length; i++)
+	{
+		if(i != working && working_slots[i] >= 0 && slot_lengths[working_slots[i]] > 0)
+		{
+			free_arena(working_slots[i]);
+			working_changed[i] = 1;
+		}
+	}
+	
+	//make room by evicting packed cards further from current than this one
+	while(ARENA_SIZE - arena_used < length)
+	{
+		int victim = -1;
+		for(int i=0; i<CACHE_SIZE; i++)
+		{
+			if(i == slot || slot_lengths[i] == 0 || working_for(i) >= 0 || notif_ids[i] == current || notif_ids[i] == previous)
+				continue;
+			if(victim < 0 || evict_before(i, victim))
+				victim = i;
+		}
+		//evicting a nearer card would only have the phone send it again
+		if(victim < 0 || evict_before(slot, victim))
+			return 0;
+		evict_slot(victim);
+	}
+	
+	slot_offsets[slot] = arena_used;
+	slot_icon_lengths[slot] = icon_length;
+	slot_lengths[slot] = length;
+	pack_rows(&arena[arena_used], &icon_bitmaps[working]);
+	pack_rows(&arena[arena_used + icon_length], &back_bitmaps[working]);
+	arena_used += length;
+	
+	working_changed[working] = 0;
+	return 1;
+}
+
+int uploading(int slot) //an upload for slot is still under way
+{
+	for(int image=0; image<2; image++)
+	{
+		Transfer* transfer = &transfers[slot][image];
+		int total_rows = image? 144 : 48;
+		if(transfer->id >= 0 && !transfer->cancelled && transfer->retries < TRANSFER_RETRIES && received_rows(transfer, total_rows) < total_rows)
+			return 1;
+	}
+	return 0;
+}
+
+int working_cost(int working) //what handing working to another slot costs, up to TAKE_SHOWN, -1 while it is the current card
+{
+	int held = working_slots[working];
+	if(working == staging_working)
+		return TAKE_IDLE; //lent to staging, prefetching the next card matters more, the staged rows go live unfinished
+	if(held < 0)
+		return 0;
+	
+	if(notif_ids[held] == current)
+		return -1;
+	
+	//previous only stays on screen while it slides out
+	if(notif_ids[held] == previous && animation_is_scheduled(transition))
+		return TAKE_SHOWN;
+	
+	//packing an upload half way only to decode it again for its next chunk is what thrashes
+	if(working_changed[working] && uploading(held))
+		return TAKE_ANY;
+	return TAKE_IDLE;
+}
+
+int restart_uploads(int slot) //rows that did not fit in the arena are asked for again, 0 when an untracked asset would be lost
+{
+	for(int image=0; image<2; image++)
+	{
+		if((image || slot_icons[slot] < 0) && transfers[slot][image].id < 0)
+			return 0;
+	}
+	
+	//the card and its text stay, its own assets start over from the first row
+	for(int image=0; image<2; image++)
+	{
+		Transfer* transfer = &transfers[slot][image];
+		if(!image && slot_icons[slot] >= 0)
+			continue;
+		memset(transfer->rows, 0, sizeof(transfer->rows));
+		transfer->retries = 0;
+		slot_loaded[slot] &= ~((image)? IMAGE_LOADED : ICON_LOADED);
+	}
+	wait_for_transfers(0);
+	return 1;
+}
+
+int acquire_working(int slot, int most) //decode slot into a working bitmap costing at most most, -1 when there is none
+{
+	int working = working_for(slot);
+	if(working >= 0)
+		return working;
+	
+	int cost = most + 1;
+	for(int i=0; i<WORKING_SIZE; i++)
+	{
+		//an upload further from current than slot gives way to it
+		int cost_i = working_cost(i);
+		if(cost_i == TAKE_ANY && evict_before(working_slots[i], slot))
+			cost_i = TAKE_IDLE;
+		if(cost_i >= 0 && cost_i < cost)
+		{
+			working = i;
+			cost = cost_i;
+		}
+	}
+	if(working < 0)
+		return -1;
+	
+	if(working == staging_working || (staging_slot >= 0 && working_slots[working] == staging_slot))
+		release_staging();
+	if(working_slots[working] >= 0 && working_changed[working])
+	{
+		if(!pack_working(working) && !restart_uploads(working_slots[working]))
+			evict_slot(working_slots[working]); //no room left, the phone has to send it again
+	}
+	
+	working_slots[working] = slot;
+	working_changed[working] = 0;
+	if(slot_lengths[slot] == 0)
+		blank_working(working);
+	else
+	{
+		uint8_t* packed = &arena[slot_offsets[slot]];
+		unpack_rows(icon_image_data[working], ICON_ROW_SIZE, 48/8, 48, 0, packed, slot_icon_lengths[slot]);
+		unpack_rows(back_image_data[working], ROW_SIZE, 144/8, 144, 0, packed + slot_icon_lengths[slot], slot_lengths[slot] - slot_icon_lengths[slot]);
+	}
+	return working;
+}
+
+uint32_t hash_packed(uint32_t hash, uint8_t* src, int length) //FNV-1a over the rows packed in src
+{
+	int i = 0;
+	while(i < length)
+	{
+		int8_t header = (int8_t)src[i++];
+		if(header == -128)
+			continue;
+		
+		if(header >= 0)
+		{
+			for(int n = 0; n <= header && i < length; n++)
+				hash = (hash ^ src[i++]) * 16777619u;
+		}
+		else if(i < length)
+		{
+			for(int n = 0; n < 1 - header; n++)
+				hash = (hash ^ src[i]) * 16777619u;
+			i++;
+		}
+	}
+	return hash;
+}
+
+uint32_t hash_card(int slot) //FNV-1a over title, text, icon rows and image rows, padding left out
+{
+	uint32_t hash = 2166136261u;
+	
+	for(char* c = slot_title(slot); *c; c++)
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+	for(char* c = slot_text(slot); *c; c++)
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+	
+	//a stored icon is hashed by its hash, little endian, instead of its rows
+	uint8_t* packed = &arena[slot_offsets[slot]];
+	if(slot_icons[slot] >= 0)
+	{
+		for(int i=0; i<4; i++)
+			hash = (hash ^ ((icon_store_hashes[slot_icons[slot]] >> (8*i)) & 0xFF)) * 16777619u;
+	}
+	else
+		hash = hash_packed(hash, packed, slot_icon_lengths[slot]);
+	
+	//arena rows carry no padding, hashing them decoded matches hashing the raw rows
+	return hash_packed(hash, packed + slot_icon_lengths[slot], slot_lengths[slot] - slot_icon_lengths[slot]);
+}
+
+int persist_room(int slot, int size, int keys) //a free record with size bytes and keys row keys to spare, saved cards the cache would evict before slot go to make room, -1 if nearer ones fill it
+{
+	while(1)
+	{
+		int record = -1;
+		int victim = -1;
+		int victim_slot = -1;
+		int used = 0;
+		int free_keys = PERSIST_ROW_KEYS;
+		
+		for(int i=0; i<PERSIST_RECORDS; i++)
+		{
+			if(persist_cards[i] < 0)
+			{
+				record = i;
+				continue;
+			}
+			used += persist_sizes[i];
+			for(int n=0; n<PERSIST_ROW_KEYS; n++)
+				free_keys -= (persist_row_keys[i] >> n) & 1;
+			
+			//a card no longer cached goes first, then the one the cache would evict first
+			int saved = find_slot(persist_cards[i]);
+			char before = (victim < 0)? saved < 0 || evict_before(saved, slot) : victim_slot >= 0 && (saved < 0 || evict_before(saved, victim_slot));
+			if(before)
+			{
+				victim = i;
+				victim_slot = saved;
+			}
+		}
+		
+		if(record >= 0 && used + size <= PERSIST_SIZE && free_keys >= keys)
+			return record;
+		if(victim < 0)
+			return -1;
+		forget_record(victim);
+	}
+}
+
+void save_card(int slot) //only called once every part of the card has arrived
+{
+	//the arena copy has to be up to date before it is hashed and saved
+	int working = working_for(slot);
+	if(working >= 0 && working_changed[working] && !pack_working(working))
+		return;
+	
+	PersistedCard header = { .card = notif_ids[slot], .hash = hash_card(slot) };
+	slot_hashes[slot] = header.hash;
+	
+	//its old copy goes either way
+	forget_card(header.card);
+	
+	int keys = (slot_lengths[slot] + PERSIST_DATA_MAX_LENGTH - 1) / PERSIST_DATA_MAX_LENGTH;
+	int size = sizeof(header) + string_lengths[slot] + slot_lengths[slot];
+	if(keys > PERSIST_ROW_KEYS || sizeof(header) + string_lengths[slot] > PERSIST_DATA_MAX_LENGTH || size > PERSIST_SIZE)
+		return; //too busy to fit the budget, the phone will resend it next time
+	
+	//the cards viewed most recently are the ones worth having at the next launch
+	int record = persist_room(slot, size, keys);
+	if(record < 0)
+		return;
+	persist_cards[record] = header.card;
+	persist_sizes[record] = size;
+	
+	uint16_t taken = persist_keys_taken();
+	int key = 0;
+	for(int n = 0; n < keys; n++)
+	{
+		int length = slot_lengths[slot] - n * PERSIST_DATA_MAX_LENGTH;
+		if(length > PERSIST_DATA_MAX_LENGTH)
+			length = PERSIST_DATA_MAX_LENGTH;
+		while(taken & (1 << key))
+			key++;
+		
+		persist_row_keys[record] |= 1 << key;
+		if(persist_write_data(PERSIST_RECORDS + key, &arena[slot_offsets[slot] + n * PERSIST_DATA_MAX_LENGTH], length) != length)
+		{
+			forget_record(record); //storage is fuller than the records account for
+			return;
+		}
+		key++;
+	}
+	
+	header.icon_length = slot_icon_lengths[slot];
+	header.length = slot_lengths[slot];
+	header.icon_hash = (slot_icons[slot] >= 0)? icon_store_hashes[slot_icons[slot]] : 0;
+	header.string_length = string_lengths[slot];
+	header.row_keys = persist_row_keys[record];
+	header.title_length = title_lengths[slot];
+	
+	uint8_t buffer[PERSIST_DATA_MAX_LENGTH];
+	memcpy(buffer, &header, sizeof(header));
+	memcpy(&buffer[sizeof(header)], &strings[string_offsets[slot]], string_lengths[slot]);
+	if(persist_write_data(record, buffer, sizeof(header) + string_lengths[slot]) != (int)(sizeof(header) + string_lengths[slot]))
+		forget_record(record);
+}
+
+int restore_card(int slot) //startup only, record slot into the empty slot of the same number, returns 1 when it held a complete card
+{
+	PersistedCard header;
+	uint8_t buffer[PERSIST_DATA_MAX_LENGTH];
+	
+	if(slot >= PERSIST_RECORDS || !persist_exists(slot) || persist_read_data(slot, buffer, sizeof(buffer)) < (int)sizeof(header))
+		return 0;
+	memcpy(&header, buffer, sizeof(header));
+	
+	if(header.string_length < header.title_length + 2 || sizeof(header) + header.string_length > PERSIST_DATA_MAX_LENGTH)
+		return 0;
+	
+	if(header.length == 0 || header.length > PERSIST_ROW_KEYS * PERSIST_DATA_MAX_LENGTH || ARENA_SIZE - arena_used < header.length)
+		return 0;
+	
+	//a key another record already holds means the headers are not what this layout wrote
+	if(header.row_keys & persist_keys_taken())
+		return 0;
+	
+	//saved rows go straight back into the arena, decoded only when drawn
+	int key = 0;
+	for(int n = 0; n * PERSIST_DATA_MAX_LENGTH < header.length; n++)
+	{
+		int length = header.length - n * PERSIST_DATA_MAX_LENGTH;
+		if(length > PERSIST_DATA_MAX_LENGTH)
+			length = PERSIST_DATA_MAX_LENGTH;
+		while(key < PERSIST_ROW_KEYS && !(header.row_keys & (1 << key)))
+			key++;
+		if(key == PERSIST_ROW_KEYS || persist_read_data(PERSIST_RECORDS + key, &arena[arena_used + n * PERSIST_DATA_MAX_LENGTH], length) != length)
+			return 0;
+		key++;
+	}
+	slot_offsets[slot] = arena_used;
+	slot_icon_lengths[slot] = header.icon_length;
+	slot_lengths[slot] = header.length;
+	arena_used += header.length;
+	
+	notif_ids[slot] = header.card;
+	char* title = (char*)&buffer[sizeof(header)];
+	store_strings(slot, title, header.title_length, title + header.title_length + 1, header.string_length - header.title_length - 2);
+	layout_card(slot);
+	
+	//the icon store is not saved, the phone is asked for the icon again in init()
+	if(header.icon_hash != 0)
+		reference_icon(slot, header.icon_hash);
+	
+	slot_hashes[slot] = header.hash;
+	slot_loaded[slot] = ALL_LOADED;
+	persist_cards[slot] = header.card;
+	persist_row_keys[slot] = header.row_keys;
+	persist_sizes[slot] = sizeof(header) + header.string_length + header.length;
+	return 1;
+}
+
+void card_loaded(int slot, uint8_t part)
+{
+	slot_loaded[slot] |= part;
+	if(slot_loaded[slot] == ALL_LOADED)
+		save_card(slot);
+}
+
+void store_text(int slot, uint8_t* bytes, int length, int title_length) //title_length -1 for the padded layout
+{
+	char* text = (char*)bytes;
+	char stored = 0;
+	
+	if(title_length >= 0 && title_length <= length)
+	{
+		//title then text, no terminators
+		stored = store_strings(slot, text, title_length, text + title_length, length - title_length);
+	}
+	else if(title_length < 0 && length >= TITLE_SIZE + TEXT_SIZE)
+	{
+		//older phones send both strings padded to TITLE_SIZE and TEXT_SIZE
+		stored = store_strings(slot, text, padded_length(text, TITLE_SIZE-1), text + TITLE_SIZE, padded_length(text + TITLE_SIZE, TEXT_SIZE-1));
+	}
+	layout_card(slot);
+	
+	//a malformed message leaves the card waiting for its text, the phone sends it again when it is viewed
+	if(stored)
+		card_loaded(slot, TEXT_LOADED);
+	
+	redraw_slot(slot, 0, 1);
+	redraw_slot(slot, 1, 1); //parallax follows the card height
+}
+
+GBitmap* stage_asset(int slot, char image, GBitmap* live) //staging bitmap to write into, NULL to write live
+{
+	if(staging_slot == slot && staging_image == image)
+		return (image)? &staging_back_bitmap : &staging_icon_bitmap;
+	
+	//off screen, or staging already taken by another asset
+	if(staging_slot >= 0 || !slot_layer(slot, image))
+		return NULL;
+	
+	//borrow the other working bitmap, only while it holds nothing on screen or half uploaded
+	int spare = -1;
+	for(int i=0; i<WORKING_SIZE; i++)
+	{
+		int cost = working_cost(i);
+		if(working_slots[i] != slot && cost >= 0 && cost <= TAKE_IDLE)
+			spare = i;
+	}
+	if(spare < 0)
+		return NULL;
+	if(working_slots[spare] >= 0 && working_changed[spare] && !pack_working(spare))
+		return NULL;
+	working_slots[spare] = -1;
+	working_changed[spare] = 0;
+	
+	//start from what is shown so rows that never arrive keep their old contents
+	staging_working = spare;
+	staging_slot = slot;
+	staging_image = image;
+	staging_back_bitmap.addr = back_image_data[spare];
+	staging_icon_bitmap.addr = back_image_data[spare];
+	memcpy(back_image_data[spare], live->addr, (image)? IMAGE_SIZE : ICON_SIZE);
+	return (image)? &staging_back_bitmap : &staging_icon_bitmap;
+}
+
+int write_rows(GBitmap* target, int command, int starting_row, uint8_t* bytes, int length) //returns the row after the last one written
+{
+	//chunk length decides the row count
+	if(command == UPDATEICON || command == UPDATEIMAGE)
+		return bitmap_copy_rows(target, starting_row, bytes, length);
+	return unpack_rows((uint8_t*)target->addr, target->row_size_bytes, target->bounds.size.w/8, target->bounds.size.h, starting_row, bytes, length);
+}
+
+void store_shared_icon(int32_t transfer_id, int32_t sequence, int slot, int command, int starting_row, uint8_t* bytes, int length)
+{
+	int icon = slot_icons[slot];
+	int last_row = write_rows(&icon_store_bitmaps[icon], command, starting_row, bytes, length);
+	
+	//not drawn until complete, then every card waiting for it has its icon
+	if(track_chunk(transfer_id, sequence, slot, 0, starting_row, last_row, 1))
+	{
+		icon_store_ready[icon] = 1;
+		for(int i=0; i<CACHE_SIZE; i++)
+		{
+			if(slot_icons[i] == icon)
+			{
+				card_loaded(i, ICON_LOADED);
+				redraw_slot(i, 0, 1);
+			}
+		}
+	}
+}
+
+void store_interlaced(int32_t transfer_id, int32_t sequence, int slot, int pass, int index, uint8_t* bytes, int length) //index counts rows within the pass
+{
+	if(transfer_cancelled(transfer_id, slot, 1))
+		return;
+	
+	int working = acquire_working(slot, (transfer_id >= 0)? TAKE_IDLE : TAKE_SHOWN);
+	if(working < 0)
+	{
+		//nothing marked, the timer asks for these rows again once a working bitmap is free
+		track_chunk(transfer_id, sequence, slot, 1, 0, 0, 1);
+		wait_for_transfers(0);
+		return;
+	}
+	
+	//passes are meant to be seen, a staged copy would hide them
+	GBitmap* live = &back_bitmaps[working];
+	release_staging_for(slot, 1);
+	
+	//rows 0, 8, 16.. then 4, 12.. then 2, 6.. then the odd rows, each filling the gap below it
+	int first = (pass == 0)? 0 : 8 >> pass;
+	int step = (pass == 0)? 8 : 16 >> pass;
+	int starting_row = first + index * step;
+	int last_row = bitmap_copy_rows_interlaced(live, starting_row, step, 8 >> pass, bytes, length);
+	working_changed[working] = 1;
+	
+	//one redraw per pass
+	int complete = track_chunk(transfer_id, sequence, slot, 1, starting_row, last_row, step);
+	if(complete || last_row + step > 144)
+		redraw_slot(slot, 1, 1);
+	if(complete)
+		card_loaded(slot, IMAGE_LOADED);
+}
+
+void store_chunk(int32_t transfer_id, int32_t sequence, int slot, int command, int starting_row, uint8_t* bytes, int length) //transfer_id -1 for untracked chunks
+{
+	char image = (command == UPDATEIMAGE || command == UPDATEIMAGE_RLE);
+	
+	if(!image && slot_icons[slot] >= 0)
+	{
+		store_shared_icon(transfer_id, sequence, slot, command, starting_row, bytes, length);
+		return;
+	}
+	
+	if(transfer_cancelled(transfer_id, slot, image))
+		return;
+	
+	//a tracked chunk can come again, so it waits rather than pack away another card's upload half way
+	//an untracked one never comes again, so it takes any bitmap not on screen for good
+	int working = acquire_working(slot, (transfer_id >= 0)? TAKE_IDLE : TAKE_SHOWN);
+	if(working < 0)
+	{
+		//nothing marked, the timer asks for these rows again once a working bitmap is free
+		track_chunk(transfer_id, sequence, slot, image, 0, 0, 1);
+		wait_for_transfers(0);
+		return;
+	}
+	
+	GBitmap* live = (image)? &back_bitmaps[working] : &icon_bitmaps[working];
+	GBitmap* staging = stage_asset(slot, image, live);
+	
+	int last_row = write_rows((staging)? staging : live, command, starting_row, bytes, length);
+	working_changed[working] = 1;
+	
+	int complete = track_chunk(transfer_id, sequence, slot, image, starting_row, last_row, 1);
+	if(staging)
+	{
+		//nothing to draw until the whole asset can be swapped in, the timeout shows an untracked one that stops short
+		if(complete)
+			release_staging();
+		else if(transfer_id < 0)
+			wait_for_transfers(1);
+	}
+	else
+		redraw_slot(slot, image, complete);
+	
+	if(complete)
+		card_loaded(slot, (image)? IMAGE_LOADED : ICON_LOADED);
+}
+
+void reference_icon_for(int slot, uint32_t hash) //ICONREF, answer have it or need it
+{
+	char have = reference_icon(slot, hash);
+	if(have)
+	{
+		card_loaded(slot, ICON_LOADED);
+		redraw_slot(slot, 0, 1);
+	}
+	send_icon_status(slot, hash, !have);
+}
+
+void apply_batch(uint8_t* bytes, int length) //run every record of a BATCH message, layers are resized once at the end
+{
+	char text_changed = 0;
+	char current_changed = 0;
+	int offset = 0;
+	
+	while(offset + (int)sizeof(BatchRecord) <= length)
+	{
+		BatchRecord record;
+		memcpy(&record, &bytes[offset], sizeof(record)); //records are not aligned
+		offset += sizeof(record);
+		if(offset + record.length > length)
+			break;
 		
-		}
-		else if(tuple_pointer->value->int8 == UPDATEICON)
+		uint8_t* data = &bytes[offset];
+		offset += record.length;
+		if(record.card < 0)
+			continue;
+		
+		int slot = load_slot(record.card);
+		if(record.command == CLEAR)
+			reset_card(slot);
+		else if(record.command == UPDATETEXT)
 		{
-			tuple_pointer = NULL;
-			tuple_pointer = dict_find(iter, BYTES);
-			if (tuple_pointer) 
-			{
-				uint8_t* byteArray = tuple_pointer->value->data;
-				
-				
-				Tuple *tuple_row = dict_find(iter, LINE);
-				
-				int starting_row = tuple_row->value->int32;
-
-				//icon_data[0] = 0;
-				//icon_data[0] = byteArray[0];
-				for(int additional_rows = 0; additional_rows < ICON_MESSAGE_ROWS; additional_rows++)
-				{
-					for(int i =0; i < 6; i++)
-					{
-						icon_image_data[id][i + (64/8)*(starting_row+additional_rows)] = byteArray[i+(48/8)*additional_rows];
-					}
-				}
-				layer_mark_dirty(card_layer_A);
-				layer_mark_dirty(card_layer_B);
-			}
+			store_text(slot, data, record.length, record.line);
+			text_changed = 1;
+			current_changed |= (record.card == current);
 		}
-		else if(tuple_pointer->value->int8 == UPDATEIMAGE)
+		else if(record.command == UPDATEICON || record.command == UPDATEIMAGE ||
+				record.command == UPDATEICON_RLE || record.command == UPDATEIMAGE_RLE)
+			store_chunk(record.transfer, record.sequence, slot, record.command, record.line, data, record.length);
+		else if(record.command == ICONREF && record.length >= 4)
 		{
-			tuple_pointer = NULL;
-			tuple_pointer = dict_find(iter, BYTES);
-			if (tuple_pointer) 
-			{
-				uint8_t* byteArray = tuple_pointer->value->data;
-				
-				Tuple *tuple_row = dict_find(iter, LINE);
-				int starting_row = tuple_row->value->int32;
-
-				for(int additional_rows = 0; additional_rows < IMAGE_MESSAGE_ROWS; additional_rows++)
-				{
-					for(int i =0; i < 18; i++)
-					{
-						//APP_LOG(APP_LOG_LEVEL_DEBUG, "row: %d byte: %d", starting_row + additional_rows, i + (160/8)*(starting_row+additional_rows));
-						back_image_data[id][i + (160/8)*(starting_row+additional_rows)] = byteArray[i+(144/8)*additional_rows];
-					}
-				}
-				layer_mark_dirty(back_layer_A);
-				layer_mark_dirty(back_layer_B);
-			}
+			uint32_t hash;
+			memcpy(&hash, data, 4);
+			reference_icon_for(slot, hash);
 		}
-		/*else if(tuple_pointer->value->int8 == ACTIONS)
-		{
-			tuple_pointer = NULL;
-			tuple_pointer = dict_find(iter, BYTES);
-			if(tuple_pointer)
-			{				
-				uint8_t* bytes = tuple_pointer->value->data;
-				
-				for(int i=0;i<30;i++){
-					actions[i] = bytes[i];
-				}
-				text_layer_set_text(actions_layer, actions);
-			}
-		}*/
-	}
 	}
+	
+	if(text_changed)
+		resize_layers();
+	if(current_changed)
+		reposition_current();
 }
 
-
  void out_sent_handler(DictionaryIterator *sent, void *context) {
    // outgoing message was delivered
+   sample_heap();
+   outbox_busy = 0;
+   send_next_message();
  }
  void out_failed_handler(DictionaryIterator *failed, AppMessageResult reason, void *context) {
-   // outgoing message failed
+   // outgoing message failed, it goes again after a while
+   STAT(stats.failed++);
+   STAT(stats.failed_reasons |= reason);
+   sample_heap();
+   outbox_failed(failed);
+   retry_outbox_later();
  }
  void in_dropped_handler(AppMessageResult reason, void *context) {
-   // incoming message dropped
+   STAT(stats.dropped++);
+   STAT(stats.dropped_reasons |= reason);
+   // incoming message dropped, whatever it carried gets asked for again
+   sample_heap();
+   release_staging_untracked();
+   wait_for_transfers(1);
  }
 
-static void update_back(GContext* ctx, int image_no)
+static void update_back(GContext* ctx, int card)
 {
-	//if same odd/even, selection = current, else selection = previous
-	int selection = (image_no % 2 == current % 2)? current : previous;
-	int card_height = MIN_CARD_HEIGHT + 4 + graphics_text_layout_get_content_size(text_strings[selection%CACHE_SIZE],
-																				 fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),GRect(0,0,142,168),GTextOverflowModeWordWrap, GTextAlignmentLeft).h;
-	if(card_height > MAX_CARD_HEIGHT)
-		card_height = MAX_CARD_HEIGHT;
+	int image_no = find_slot(card);
+	if(image_no < 0 || working_for(image_no) < 0)
+		return;
 	
-	int image_pos = 0-(card_height / 4);
-	
-	graphics_draw_bitmap_in_rect(ctx, &back_bitmaps[image_no],GRect(0,image_pos,144,144));
+	graphics_draw_bitmap_in_rect(ctx, &back_bitmaps[working_for(image_no)],GRect(0,card_layouts[image_no].image_pos,144,144));
 }
 
 
 static void update_expanded_layer(Layer *me, GContext* ctx)
 {
+	STAT(stats.redraws[EXPANDED_LAYER]++);
+	TRACE_BEGIN(EXPANDED_LAYER);
 	graphics_context_set_fill_color(ctx, GColorWhite);
 	graphics_fill_rect(ctx, GRect(0, 0, 144, 168), 0, GCornerNone);
 	
+	int slot = find_slot(current);
+	if(slot < 0)
+	{
+		TRACE_END(EXPANDED_LAYER);
+		return;
+	}
+	
 	graphics_context_set_text_color(ctx, GColorBlack);	
 	graphics_draw_text(ctx, 
-					   text_strings[current%CACHE_SIZE],  
+					   slot_text(slot),  
 					   fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
 					   GRect( 2, -55, 142, 168), //magic number: 55
 					   GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
+	TRACE_END(EXPANDED_LAYER);
 }
 
 static void update_back_layer_A(Layer *me, GContext* ctx)
 {
-	int image_no = (current % 2 == 0)?current:previous; //"current image" when even
-	image_no = image_no%CACHE_SIZE;
-	update_back(ctx, image_no);
+	STAT(stats.redraws[BACK_LAYER_A]++);
+	TRACE_BEGIN(BACK_LAYER_A);
+	int card = (current_on_A())?current:previous; //"current image" when on A
+	update_back(ctx, card);
+	TRACE_END(BACK_LAYER_A);
 }
 
 static void update_back_layer_B(Layer *me, GContext* ctx)
 {
-	int image_no = (current % 2 == 1)?current:previous; //"current image" when odd
-	image_no = image_no%CACHE_SIZE;
-	update_back(ctx, image_no);
+	STAT(stats.redraws[BACK_LAYER_B]++);
+	TRACE_BEGIN(BACK_LAYER_B);
+	int card = (!current_on_A())?current:previous; //"current image" when on B
+	update_back(ctx, card);
+	TRACE_END(BACK_LAYER_B);
 }
 
-static void update_card(GContext* ctx, int card_no)
+static void update_card(GContext* ctx, int card)
 {
-	int title_height = graphics_text_layout_get_content_size(title_strings[card_no],fonts_get_system_font(FONT_KEY_GOTHIC_18),GRect(0,0,142-54,168),GTextOverflowModeWordWrap, GTextAlignmentLeft).h;
+	int card_no = find_slot(card);
+	if(card_no < 0)
+		return;
+	
+	int title_height = card_layouts[card_no].title_height;
 	
 	//card
 	graphics_context_set_fill_color(ctx, GColorWhite);
@@ -398,25 +2176,31 @@ static void update_card(GContext* ctx, int card_no)
 	graphics_fill_rect(ctx, GRect(144-53, 1, 52, 52), 3, GCornersAll);
 	
 	//icon
-	graphics_draw_bitmap_in_rect(ctx, &icon_bitmaps[card_no],GRect(144-51,3,48,48));
+	if(slot_icons[card_no] >= 0)
+	{
+		if(icon_store_ready[slot_icons[card_no]])
+			graphics_draw_bitmap_in_rect(ctx, &icon_store_bitmaps[slot_icons[card_no]],GRect(144-51,3,48,48));
+	}
+	else if(working_for(card_no) >= 0)
+		graphics_draw_bitmap_in_rect(ctx, &icon_bitmaps[working_for(card_no)],GRect(144-51,3,48,48));
 	
 	//text
 	graphics_context_set_text_color(ctx, GColorBlack);	
 	if(title_height > 18)
 		graphics_draw_text(ctx, 
-						   title_strings[card_no],  
+						   slot_title(card_no),  
 						   fonts_get_system_font(FONT_KEY_GOTHIC_18),
 						   GRect( 2, 12, 142-54, 20),
 						   GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
 	else
 		graphics_draw_text(ctx, 
-					   title_strings[card_no],  
+					   slot_title(card_no),  
 					   fonts_get_system_font(FONT_KEY_GOTHIC_18),
 					   GRect( 2, 26, 142-54, 20),
 					   GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
 	
 	graphics_draw_text(ctx, 
-					   text_strings[card_no],  
+					   slot_text(card_no),  
 					   fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
 					   GRect( 2, MIN_CARD_HEIGHT - 7, 142, 60),
 					   (expanded_visible)?GTextOverflowModeWordWrap:GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
@@ -424,22 +2208,28 @@ static void update_card(GContext* ctx, int card_no)
 
 static void update_card_layer_A(Layer *me, GContext* ctx)
 {
-	int card_no = (current % 2 == 0)?current:previous; //"current card" when even
-	card_no = card_no%CACHE_SIZE;
+	STAT(stats.redraws[CARD_LAYER_A]++);
+	TRACE_BEGIN(CARD_LAYER_A);
+	int card = (current_on_A())?current:previous; //"current card" when on A
 	
-	update_card(ctx, card_no);
+	update_card(ctx, card);
+	TRACE_END(CARD_LAYER_A);
 }
 
 static void update_card_layer_B(Layer *me, GContext* ctx)
 {
-	int card_no = (current % 2 == 1)?current:previous; //"current card" when odd
-	card_no = card_no%CACHE_SIZE;
+	STAT(stats.redraws[CARD_LAYER_B]++);
+	TRACE_BEGIN(CARD_LAYER_B);
+	int card = (!current_on_A())?current:previous; //"current card" when on B
 	
-	update_card(ctx, card_no);
+	update_card(ctx, card);
+	TRACE_END(CARD_LAYER_B);
 }
 
 static void update_watchface(Layer *me, GContext* ctx)
 {
+	STAT(stats.redraws[WATCHFACE_LAYER]++);
+	TRACE_BEGIN(WATCHFACE_LAYER);
 	char current_time[10];
 	
 	graphics_context_set_fill_color(ctx, GColorBlack );
@@ -453,46 +2243,109 @@ static void update_watchface(Layer *me, GContext* ctx)
 					   fonts_get_system_font(FONT_KEY_BITHAM_42_BOLD),
 					   GRect( 2, 2, 140, 164),
 					   GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
+	TRACE_END(WATCHFACE_LAYER);
+}
+
+
+
+int32_t ease(AnimationCurve curve, int32_t progress) //fixed point easing, progress 0 to ANIMATION_NORMALIZED_MAX
+{
+	if(curve != AnimationCurveEaseOut)
+		return progress;
+	
+	int32_t step = progress * EASE_STEPS / ANIMATION_NORMALIZED_MAX;
+	if(step >= EASE_STEPS)
+		return ANIMATION_NORMALIZED_MAX;
+	
+	//interpolate between table entries
+	int32_t step_start = step * ANIMATION_NORMALIZED_MAX / EASE_STEPS;
+	int32_t remainder = (progress - step_start) * EASE_STEPS;
+	return ease_out_table[step] + (ease_out_table[step+1] - ease_out_table[step]) * remainder / ANIMATION_NORMALIZED_MAX;
+}
+
+static void update_transition(Animation* animation, const uint32_t distance_normalized)
+{
+	TRACE_BEGIN(ANIMATION_TICK);
+	
+	//one pass over every layer from the same progress value
+	for(int i=0; i<transition_track_count; i++)
+	{
+		TransitionTrack* track = &transition_tracks[i];
+		int32_t d = ease(track->curve, distance_normalized);
+		GRect frame = GRect(
+			track->from.origin.x + (track->to.origin.x - track->from.origin.x) * d / ANIMATION_NORMALIZED_MAX,
+			track->from.origin.y + (track->to.origin.y - track->from.origin.y) * d / ANIMATION_NORMALIZED_MAX,
+			track->from.size.w + (track->to.size.w - track->from.size.w) * d / ANIMATION_NORMALIZED_MAX,
+			track->from.size.h + (track->to.size.h - track->from.size.h) * d / ANIMATION_NORMALIZED_MAX);
+		
+		//only touch layers that actually moved this tick
+		GRect current_frame = layer_get_frame(track->layer);
+		if(!grect_equal(&frame, &current_frame))
+			layer_set_frame(track->layer, frame);
+	}
+	
+	TRACE_END(ANIMATION_TICK);
 }
 
+static const AnimationImplementation transition_implementation = {
+	.update = update_transition
+};
+
+void create_animations()
+{
+	transition = animation_create();
+	animation_set_implementation(transition, &transition_implementation);
+	animation_set_curve(transition, AnimationCurveLinear); //easing is done per track
+	animation_set_duration(transition, ANIMATION_DURATION);
+}
 
+void stop_animations()
+{
+	//unschedule any previous transition, the animation itself is reused
+	animation_unschedule(transition);
+	transition_track_count = 0;
+	pending_scroll = 0; //presses queued behind a transition that was cut short are dropped
+	
+	sample_heap();
+}
 
 void destroy_animations()
 {
-	//unschedule any previous animation
-	animation_unschedule((Animation*)back_animation_old);
-	animation_unschedule((Animation*)back_animation_new);
-	animation_unschedule((Animation*)card_animation_old);
-	animation_unschedule((Animation*)card_animation_new);
-	animation_unschedule((Animation*)expanded_animation);
-	
-	//destroy memory used for previous animation
-	if(back_animation_old != NULL)
-		property_animation_destroy(back_animation_old);
-	if(back_animation_new != NULL)
-		property_animation_destroy(back_animation_new);
-	if(card_animation_old != NULL)
-		property_animation_destroy(card_animation_old);
-	if(card_animation_new != NULL)
-		property_animation_destroy(card_animation_new);
-	if(expanded_animation != NULL)
-		property_animation_destroy(expanded_animation);
-	
-	//make NULL to avoid redestroying memory
-	back_animation_old = NULL;
-	back_animation_new = NULL;
-	card_animation_old = NULL;
-	card_animation_new = NULL;
-	expanded_animation = NULL;
+	stop_animations();
+	animation_destroy(transition);
+}
+
+void animate_frame(Layer* layer, GRect from, GRect to, AnimationCurve curve) //add a layer to the transition
+{
+	//a layer only follows one track
+	int i = 0;
+	while(i < transition_track_count && transition_tracks[i].layer != layer)
+		i++;
+	if(i == MAX_TRACKS)
+		return;
+	if(i == transition_track_count)
+		transition_track_count++;
+	
+	transition_tracks[i] = (TransitionTrack){ .layer = layer, .from = from, .to = to, .curve = curve };
+	layer_set_frame(layer, from);
+	
+	if(!animation_is_scheduled(transition))
+	{
+		STAT(stats.animations++);
+		animation_set_duration(transition, (fast_scroll)? FAST_SCROLL_DURATION : ANIMATION_DURATION);
+		fast_scroll = 0;
+		animation_schedule(transition);
+	}
 }
 
 void show_watchface()
 {
-	destroy_animations();
+	stop_animations();
 	resize_layers();
 	reposition_current();
 	
-	int card_height = layer_get_frame(card_layer_A).size.h;
+	Layer* current_card = (current_on_A())?card_layer_A:card_layer_B;
+	int card_height = layer_get_frame(current_card).size.h;
 	APP_LOG(APP_LOG_LEVEL_DEBUG, "%d", card_height);
 	GRect card_from = GRect(0,168-card_height,144,card_height);
 	GRect card_to = GRect(0,168-MIN_CARD_HEIGHT,144,card_height);//SET THIS TO THE HEIGHT OF CARD TOP
@@ -500,27 +2353,22 @@ void show_watchface()
 	GRect watchface_to = GRect(0, 0, 144, 168);
 	
 	//animate card
-	card_animation_old = property_animation_create_layer_frame(card_layer_A, &card_from, &card_to);
-	animation_set_curve((Animation*) card_animation_old, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) card_animation_old, 300);
-	animation_schedule((Animation*) card_animation_old);
+	animate_frame(current_card, card_from, card_to, AnimationCurveEaseOut);
 	
 	//animate watchface
-	card_animation_new = property_animation_create_layer_frame(watchface_layer, &watchface_from, &watchface_to);
-	animation_set_curve((Animation*) card_animation_new, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) card_animation_new, 300);
-	animation_schedule((Animation*) card_animation_new);
+	animate_frame(watchface_layer, watchface_from, watchface_to, AnimationCurveEaseOut);
 	
 	watchface_visible = 1;
 }
 
 void hide_watchface()
 {
-	destroy_animations();
+	stop_animations();
 	//watchface_visible = 0;
 	resize_layers();
 	
-	int card_height = layer_get_frame(card_layer_A).size.h;
+	Layer* current_card = (current_on_A())?card_layer_A:card_layer_B;
+	int card_height = layer_get_frame(current_card).size.h;
 	APP_LOG(APP_LOG_LEVEL_DEBUG, "%d", card_height);
 	GRect card_from = GRect(0,168-MIN_CARD_HEIGHT,144,card_height);//SET THIS TO THE HEIGHT OF CARD TOP
 	GRect card_to = GRect(0,168-card_height,144,card_height);
@@ -528,93 +2376,61 @@ void hide_watchface()
 	GRect watchface_to = GRect(0,-168,144,168);
 	
 	//animate card
-	card_animation_new = property_animation_create_layer_frame(card_layer_A, &card_from, &card_to);
-	animation_set_curve((Animation*) card_animation_new, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) card_animation_new, 300);
-	animation_schedule((Animation*) card_animation_new);
+	animate_frame(current_card, card_from, card_to, AnimationCurveEaseOut);
 	
 	//animate watchface
-	card_animation_old = property_animation_create_layer_frame(watchface_layer, &watchface_from, &watchface_to);
-	animation_set_curve((Animation*) card_animation_old, AnimationCurveLinear);
-	animation_set_duration((Animation*) card_animation_old, 300);
-	animation_schedule((Animation*) card_animation_old);
+	animate_frame(watchface_layer, watchface_from, watchface_to, AnimationCurveLinear);
 	
 	watchface_visible = 0;
 }
 
 void hide_expanded_up_press()
 {
-	destroy_animations();
+	stop_animations();
 	
-	Layer* current_card = (current%2 == 0)?card_layer_A:card_layer_B;
+	Layer* current_card = (current_on_A())?card_layer_A:card_layer_B;
 	
-	int card_height = layer_get_frame(current_card).size.h;
 	GRect card_from = layer_get_frame(current_card);
 	GRect card_to = GRect(0,168-card_from.size.h,144,card_from.size.h);
 	GRect expanded_from = GRect(0,EXPAND_SIZE, 144, 168-EXPAND_SIZE);
 	GRect expanded_to = GRect(0, 168, 144, 168-EXPAND_SIZE);
 	
 	//animate card
-	card_animation_old = property_animation_create_layer_frame(current_card, &card_from, &card_to);
-	animation_set_curve((Animation*) card_animation_old, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) card_animation_old, 300);
-	animation_schedule((Animation*) card_animation_old);
+	animate_frame(current_card, card_from, card_to, AnimationCurveEaseOut);
 	
 	//animate expanded layer
-	expanded_animation = property_animation_create_layer_frame(expanded_layer, &expanded_from, &expanded_to);
-	animation_set_curve((Animation*) expanded_animation, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) expanded_animation, 300);
-	animation_schedule((Animation*) expanded_animation);
+	animate_frame(expanded_layer, expanded_from, expanded_to, AnimationCurveEaseOut);
 	
 	expanded_visible = 0;
 }
 
 void hide_expanded_down_press()
 {
-	animation_unschedule((Animation*)expanded_animation);
-	
-	//destroy memory used for previous animation
-	if(expanded_animation != NULL)
-		property_animation_destroy(expanded_animation);
-	
-	//make NULL to avoid redestroying memory
-	expanded_animation = NULL;
-	
 	GRect expanded_from = GRect(0,EXPAND_SIZE, 144, 168-EXPAND_SIZE);
 	GRect expanded_to = GRect(0, 0-(168-EXPAND_SIZE), 144, 168-EXPAND_SIZE);
 	
 	//animate expanded layer
-	expanded_animation = property_animation_create_layer_frame(expanded_layer, &expanded_from, &expanded_to);
-	animation_set_curve((Animation*) expanded_animation, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) expanded_animation, 300);
-	animation_schedule((Animation*) expanded_animation);
+	animate_frame(expanded_layer, expanded_from, expanded_to, AnimationCurveEaseOut);
 	
 	expanded_visible = 0;
 }
 
 void show_expanded()
 {	
-	destroy_animations();
+	stop_animations();
 	
-	Layer* current_card = (current%2 == 0)?card_layer_A:card_layer_B;
+	Layer* current_card = (current_on_A())?card_layer_A:card_layer_B;
 	
-	int card_height = layer_get_frame(current_card).size.h;
 	GRect card_from = layer_get_frame(current_card);
 	GRect card_to = GRect(0,EXPAND_SIZE-card_from.size.h,144,card_from.size.h);
 	GRect expanded_from = GRect(0,168, 144, 168-EXPAND_SIZE);
 	GRect expanded_to = GRect(0, EXPAND_SIZE, 144, 168-EXPAND_SIZE);
 	
 	//animate card
-	card_animation_old = property_animation_create_layer_frame(current_card, &card_from, &card_to);
-	animation_set_curve((Animation*) card_animation_old, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) card_animation_old, 300);
-	animation_schedule((Animation*) card_animation_old);
+	animate_frame(current_card, card_from, card_to, AnimationCurveEaseOut);
 	
 	//animate expanded layer
-	expanded_animation = property_animation_create_layer_frame(expanded_layer, &expanded_from, &expanded_to);
-	animation_set_curve((Animation*) expanded_animation, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) expanded_animation, 300);
-	animation_schedule((Animation*) expanded_animation);
+	animate_frame(expanded_layer, expanded_from, expanded_to, AnimationCurveEaseOut);
 	
 	expanded_visible = 1;
 }
@@ -637,10 +2453,10 @@ void animate()
 	Layer** old_card_layer;
 	Layer** new_card_layer;
 
-	//memory cleanup
-	destroy_animations();
+	//stop the previous transition
+	stop_animations();
 
-	if(current % 2 == 0) //if even, we must be moving to layer A
+	if(current_on_A()) //we must be moving to layer A
 	{
 		old_back_layer = &back_layer_B;
 		old_card_layer = &card_layer_B;
@@ -687,28 +2503,16 @@ void animate()
 	}
 	
 	//old background layer
-	back_animation_old = property_animation_create_layer_frame(*old_back_layer, &old_back_from, &old_back_to);
-	animation_set_curve((Animation*) back_animation_old, AnimationCurveLinear);
-	animation_set_duration((Animation*) back_animation_old, 300);
-	animation_schedule((Animation*) back_animation_old);
+	animate_frame(*old_back_layer, old_back_from, old_back_to, AnimationCurveLinear);
 	
 	//new background layer
-	back_animation_new = property_animation_create_layer_frame(*new_back_layer, &new_back_from, &new_back_to);
-	animation_set_curve((Animation*) back_animation_new, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) back_animation_new, 300);
-	animation_schedule((Animation*) back_animation_new);
+	animate_frame(*new_back_layer, new_back_from, new_back_to, AnimationCurveEaseOut);
 	
 	//old card layer
-	card_animation_old = property_animation_create_layer_frame(*old_card_layer, &old_card_from, &old_card_to);
-	animation_set_curve((Animation*) card_animation_old, AnimationCurveLinear);
-	animation_set_duration((Animation*) card_animation_old, 300);
-	animation_schedule((Animation*) card_animation_old);
+	animate_frame(*old_card_layer, old_card_from, old_card_to, AnimationCurveLinear);
 	
 	//new card layer
-	card_animation_new = property_animation_create_layer_frame(*new_card_layer, &new_card_from, &new_card_to);
-	animation_set_curve((Animation*) card_animation_new, AnimationCurveEaseOut);
-	animation_set_duration((Animation*) card_animation_new, 300);
-	animation_schedule((Animation*) card_animation_new);
+	animate_frame(*new_card_layer, new_card_from, new_card_to, AnimationCurveEaseOut);
 }
 
 void press_down(ClickRecognizerRef recognizer, void *context) 
@@ -718,6 +2522,7 @@ void press_down(ClickRecognizerRef recognizer, void *context)
 
 void release_down(ClickRecognizerRef recognizer, void *context) 
 {
+	TRACE_INPUT(BUTTON_DOWN, 0);
 	if(long_press_down)
 		long_press_down = 0;
 	else
@@ -726,6 +2531,12 @@ void release_down(ClickRecognizerRef recognizer, void *context)
 		{
 			hide_watchface();
 		}
+		else if(!expanded_visible && animation_is_scheduled(transition))
+		{
+			//wait for the transition, only the card it ends on gets drawn
+			if(current + pending_scroll < total_cards - 1)
+				pending_scroll++;
+		}
 		else if(current < total_cards - 1)
 		{
 			
@@ -734,6 +2545,10 @@ void release_down(ClickRecognizerRef recognizer, void *context)
 				//update current valuees
 				previous = current;
 				current++;
+				load_slot(current);
+				view_card(current);
+				send_viewing();
+				keep_radio_awake();
 				reposition_new();
 				resize_layers();
 				reposition_old();
@@ -742,6 +2557,7 @@ void release_down(ClickRecognizerRef recognizer, void *context)
 
 				//animate
 				animate();
+				acquire_working(find_slot(current), TAKE_ANY); //once the slide is scheduled, previous keeps the bitmap it slides out on
 			
 			if(expanded_visible)
 			{
@@ -755,6 +2571,7 @@ void release_down(ClickRecognizerRef recognizer, void *context)
 
 void long_down(ClickRecognizerRef recognizer, void  *context)
 {
+	TRACE_INPUT(BUTTON_LONG_DOWN, 0);
 	if(!expanded_visible)
 	{
 		char expandable = true; //?
@@ -773,19 +2590,30 @@ void press_up(ClickRecognizerRef recognizer, void *context)
 
 void release_up(ClickRecognizerRef recognizer, void *context) 
 {
+	TRACE_INPUT(BUTTON_UP, 0);
 	if(expanded_visible)
 	{
 		hide_expanded_up_press();
 	}
+	else if(!watchface_visible && animation_is_scheduled(transition))
+	{
+		if(current + pending_scroll > 0)
+			pending_scroll--;
+	}
 	else if(current > 0)
 	{
 		previous = current;
 		current--;
+		load_slot(current);
+		view_card(current);
+		send_viewing();
+		keep_radio_awake();
 		resize_layers();
 		layer_mark_dirty(back_layer_A);
 		layer_mark_dirty(back_layer_B);
 		
 		animate();
+		acquire_working(find_slot(current), TAKE_ANY); //once the slide is scheduled, previous keeps the bitmap it slides out on
 	}
 	else if(current == 0 && !watchface_visible)
 	{
@@ -793,6 +2621,300 @@ void release_up(ClickRecognizerRef recognizer, void *context)
 	}
 }
 
+void jump_to_card(int card) //VIEW, show card with the usual transition
+{
+	if(card == current || (total_cards > 0 && card >= total_cards))
+		return;
+	
+	char was_on_A = current_on_A();
+	previous = current;
+	current = card;
+	
+	//the new card goes on the layer that is not showing, under the watchface nothing moves
+	if((current_on_A() == was_on_A) != watchface_visible)
+		layer_flip = !layer_flip;
+	
+	load_slot(current);
+	view_card(current);
+	send_viewing();
+	keep_radio_awake();
+	
+	if(watchface_visible)
+	{
+		acquire_working(find_slot(current), TAKE_ANY);
+		resize_layers();
+		layer_mark_dirty(back_layer_A);
+		layer_mark_dirty(back_layer_B);
+		layer_mark_dirty(card_layer_A);
+		layer_mark_dirty(card_layer_B);
+		return;
+	}
+	
+	if(current > previous)
+	{
+		reposition_new();
+		resize_layers();
+		reposition_old();
+	}
+	else
+		resize_layers();
+	layer_mark_dirty(back_layer_A);
+	layer_mark_dirty(back_layer_B);
+	
+	animate();
+	acquire_working(find_slot(current), TAKE_ANY); //once the slide is scheduled, previous keeps the bitmap it slides out on
+	
+	if(expanded_visible)
+		hide_expanded_down_press();
+}
+
+void resume_transfers() //previous has given back its working bitmap, uploads turned away meanwhile ask again now rather than at the timeout
+{
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		if(working_for(i) >= 0)
+			continue;
+		
+		for(int image=0; image<2; image++)
+		{
+			Transfer* transfer = &transfers[i][image];
+			int total_rows = image? 144 : 48;
+			if(transfer->id >= 0 && !transfer->cancelled && transfer->retries < TRANSFER_RETRIES && received_rows(transfer, total_rows) < total_rows)
+				send_transfer_status(transfer);
+		}
+	}
+}
+
+void transition_stopped(Animation* animation, bool finished, void* context)
+{
+	//previous has slid out
+	release_staging_off_screen();
+	resume_transfers();
+	
+	if(!finished || pending_scroll == 0)
+		return;
+	
+	//every press made during the transition becomes one shorter jump
+	int card = current + pending_scroll;
+	pending_scroll = 0;
+	fast_scroll = 1;
+	jump_to_card(card);
+	fast_scroll = 0;
+}
+
+void move_cards(int first, int shift) //MOVE, renumber every cached card from first on by shift, nothing is resent
+{
+	if(shift == 0)
+		return;
+	
+	char was_on_A = current_on_A();
+	
+	//cards landing on a number still in use replace it
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		if(notif_ids[i] >= 0 && notif_ids[i] < first && notif_ids[i] >= first + shift)
+			evict_slot(i);
+	}
+	
+	//so do evictions the phone has not heard about yet, the phone renumbered its own
+	for(int i=0; i<evicted_count; i++)
+	{
+		if(evicted_cards[i] < first)
+			continue;
+		
+		evicted_cards[i] += shift;
+		if(evicted_cards[i] < 0)
+			evicted_cards[i--] = evicted_cards[--evicted_count];
+	}
+	
+	//saved cards follow their new numbers
+	for(int i=0; i<PERSIST_RECORDS; i++)
+	{
+		if(persist_cards[i] < first)
+			continue;
+		
+		persist_cards[i] += shift;
+		if(persist_cards[i] < 0)
+			forget_record(i);
+	}
+	
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		if(notif_ids[i] < first)
+			continue;
+		
+		notif_ids[i] += shift;
+		if(notif_ids[i] < 0)
+			evict_slot(i);
+		else if(slot_loaded[i] == ALL_LOADED && persist_record(notif_ids[i]) >= 0)
+			save_card(i); //the saved card number is out of date
+	}
+	
+	//keep showing the same notification on the same layers
+	if(current >= first)
+		current += shift;
+	if(previous >= first)
+		previous += shift;
+	if(current >= total_cards && total_cards > 0)
+		current = total_cards - 1;
+	if(current < 0)
+		current = 0;
+	
+	//previous may be gone or renumbered onto current, a neighbour on the same side stands in
+	if(previous == current || find_slot(previous) < 0)
+		previous = (previous < current)? current - 1 : current + 1;
+	if(current_on_A() != was_on_A)
+		layer_flip = !layer_flip;
+	
+	acquire_working(load_slot(current), TAKE_ANY);
+	resize_layers();
+	if(!animation_is_scheduled(transition))
+		reposition_current();
+	layer_mark_dirty(back_layer_A);
+	layer_mark_dirty(back_layer_B);
+	layer_mark_dirty(card_layer_A);
+	layer_mark_dirty(card_layer_B);
+	send_viewing();
+}
+
+void in_received_handler(DictionaryIterator *iter, void *context) {
+
+	//vibes_short_pulse();
+	
+	keep_radio_awake();
+	
+#if STATS
+	uint32_t started = now_ms();
+	Tuple *command_tuple = dict_find(iter, COMMAND);
+	int command = (command_tuple)? command_tuple->value->int8 : -1;
+	stats.bytes_received += dict_size(iter);
+#endif
+	
+	Tuple *tuple_pointer = dict_find(iter, TOTAL);
+	if(tuple_pointer)
+		total_cards = tuple_pointer->value->int32;
+	
+	tuple_pointer = dict_find(iter,ID);
+	int card = (tuple_pointer)? tuple_pointer->value->int32 : -1;
+	
+	tuple_pointer = NULL;
+	
+	tuple_pointer = dict_find(iter, COMMAND);
+	TRACE_INPUT(MESSAGE_RECEIVED, (tuple_pointer)? tuple_pointer->value->int8 : 0xFF);
+	if(tuple_pointer && tuple_pointer->value->int8 == REPORT)
+	{
+		//not about a card, answer with the stats block
+		STAT(report_pending = 1);
+		send_next_message();
+	}
+	else if(tuple_pointer && tuple_pointer->value->int8 == DUMPTRACE)
+	{
+#if TRACE
+		if(trace_dump_remaining == 0)
+			trace_dump_remaining = trace_count;
+#endif
+		send_next_message();
+	}
+	else if(tuple_pointer && tuple_pointer->value->int8 == MOVE)
+	{
+		//ID is the first card renumbered, not one to load
+		Tuple *shift_tuple = dict_find(iter, SHIFT);
+		if(card >= 0 && shift_tuple)
+			move_cards(card, shift_tuple->value->int32);
+	}
+	else if(tuple_pointer && tuple_pointer->value->int8 == VIEW)
+	{
+		if(card >= 0)
+			jump_to_card(card);
+	}
+	else if(tuple_pointer && tuple_pointer->value->int8 == BATCH)
+	{
+		//records for any number of cards, ID is not used
+		tuple_pointer = dict_find(iter, BYTES);
+		if(tuple_pointer)
+			apply_batch(tuple_pointer->value->data, tuple_pointer->length);
+	}
+	else if(card >= 0)
+	{
+	int id = load_slot(card);
+	
+	if(tuple_pointer)
+	{
+		if(tuple_pointer->value->int8 == CLEAR)
+		{
+				reset_card(id);
+		}
+		else if(tuple_pointer->value->int8 == ICONREF)
+		{
+			tuple_pointer = dict_find(iter, HASH);
+			if(tuple_pointer)
+				reference_icon_for(id, tuple_pointer->value->uint32);
+		}
+		else if(tuple_pointer->value->int8 == UPDATETEXT)
+		{
+			tuple_pointer = NULL;
+			tuple_pointer = dict_find(iter, BYTES);
+			if(tuple_pointer)
+			{				
+				Tuple *title_tuple = dict_find(iter, TITLE_LENGTH);
+				store_text(id, tuple_pointer->value->data, tuple_pointer->length, (title_tuple)? title_tuple->value->int32 : -1);
+				
+				resize_layers();
+				if(current == card)
+					reposition_current();
+			}
+			
+		
+		}
+		else if(tuple_pointer->value->int8 == UPDATEICON || tuple_pointer->value->int8 == UPDATEIMAGE ||
+				tuple_pointer->value->int8 == UPDATEICON_RLE || tuple_pointer->value->int8 == UPDATEIMAGE_RLE)
+		{
+			int command = tuple_pointer->value->int8;
+			tuple_pointer = NULL;
+			tuple_pointer = dict_find(iter, BYTES);
+			if (tuple_pointer) 
+			{
+				Tuple *tuple_row = dict_find(iter, LINE);
+				Tuple *tuple_pass = dict_find(iter, PASS);
+				Tuple *tuple_transfer = dict_find(iter, TRANSFER);
+				Tuple *tuple_sequence = dict_find(iter, SEQUENCE);
+				int32_t transfer_id = (tuple_transfer)? tuple_transfer->value->int32 : -1;
+				int32_t sequence = (tuple_sequence)? tuple_sequence->value->int32 : -1;
+				if(!tuple_row)
+					drop_chunk(transfer_id, sequence, id, command == UPDATEIMAGE || command == UPDATEIMAGE_RLE);
+				else if(tuple_pass && command == UPDATEIMAGE && tuple_pass->value->int32 >= 0 && tuple_pass->value->int32 < INTERLACE_PASSES)
+					store_interlaced(transfer_id, sequence, id, tuple_pass->value->int32, tuple_row->value->int32, tuple_pointer->value->data, tuple_pointer->length);
+				else
+					store_chunk(transfer_id, sequence, id, command, tuple_row->value->int32, tuple_pointer->value->data, tuple_pointer->length);
+			}
+		}
+		/*else if(tuple_pointer->value->int8 == ACTIONS)
+		{
+			tuple_pointer = NULL;
+			tuple_pointer = dict_find(iter, BYTES);
+			if(tuple_pointer)
+			{				
+				uint8_t* bytes = tuple_pointer->value->data;
+				
+				for(int i=0;i<30;i++){
+					actions[i] = bytes[i];
+				}
+				text_layer_set_text(actions_layer, actions);
+			}
+		}*/
+	}
+	}
+	
+#if STATS
+	if(command >= 0 && command < COMMAND_COUNT)
+	{
+		stats.received[command]++;
+		stats.handler_ms[command] += now_ms() - started;
+	}
+#endif
+	sample_heap();
+}
+
 void subscribe_buttons(Window *window) 
 {
 	window_raw_click_subscribe(BUTTON_ID_DOWN, press_down, release_down, NULL);
@@ -830,12 +2952,47 @@ void init()
 	expanded_layer = layer_create(GRect(0,168,144,168-50));
 	layer_set_update_proc(expanded_layer, update_expanded_layer);
 	
-	for(int i=0; i<CACHE_SIZE; i++)
-	{	
+	create_animations();
+	animation_set_handlers(transition, (AnimationHandlers){ .stopped = transition_stopped }, NULL);
+	
+	for(int i=0; i<WORKING_SIZE; i++)
+	{
 		back_bitmaps[i] = (GBitmap){.addr = back_image_data[i], .bounds = GRect(0,0,144,144), .row_size_bytes = ROW_SIZE};
 		icon_bitmaps[i] = (GBitmap){.addr = icon_image_data[i], .bounds = GRect(0,0,48,48), .row_size_bytes = ICON_ROW_SIZE};
-		reset_card(i);
+		working_slots[i] = -1;
+	}
+	staging_back_bitmap = (GBitmap){.addr = back_image_data[0], .bounds = GRect(0,0,144,144), .row_size_bytes = ROW_SIZE};
+	staging_icon_bitmap = (GBitmap){.addr = back_image_data[0], .bounds = GRect(0,0,48,48), .row_size_bytes = ICON_ROW_SIZE};
+	
+	for(int i=0; i<ICON_STORE_SIZE; i++)
+		icon_store_bitmaps[i] = (GBitmap){.addr = icon_store_data[i], .bounds = GRect(0,0,48,48), .row_size_bytes = ICON_ROW_SIZE};
+	for(int i=0; i<CACHE_SIZE; i++)
+		slot_icons[i] = -1;
+	for(int i=0; i<PERSIST_RECORDS; i++)
+		persist_cards[i] = -1;
+	
+	for(int i=0; i<CACHE_SIZE; i++)
+	{	
+		//cards saved last time are painted straight away
+		if(!restore_card(i))
+		{
+			notif_ids[i] = -1;
+			reset_card(i);
+		}
+		else if(notif_ids[i] >= total_cards)
+			total_cards = notif_ids[i] + 1;
+	}
+	
+	//keys no restored card holds, left by a save cut short or an older layout, would only eat into PERSIST_SIZE
+	uint16_t taken = persist_keys_taken();
+	for(int key=0; key<PERSIST_RECORDS + PERSIST_ROW_KEYS; key++)
+	{
+		char held = (key < PERSIST_RECORDS)? persist_cards[key] >= 0 : (taken >> (key - PERSIST_RECORDS)) & 1;
+		if(!held && persist_exists(key))
+			persist_delete(key);
 	}
+	acquire_working(load_slot(current), TAKE_ANY);
+	acquire_working(load_slot(previous), TAKE_ANY);
 	
 	resize_layers();
 	
@@ -857,17 +3014,36 @@ void init()
 	app_message_register_outbox_failed(out_failed_handler);
 
 	//set size
-	const uint32_t inbound_size = 512;
-	const uint32_t outbound_size = 64;
-	app_message_open(inbound_size, outbound_size);
-	
-	app_comm_set_sniff_interval(SNIFF_INTERVAL_REDUCED);
-	
-	DictionaryIterator *iter;
- 	app_message_outbox_begin(&iter);
-	Tuplet value = TupletInteger(1, 0);
-	dict_write_tuplet(iter, &value);
-	app_message_outbox_send();
+	inbox_size = app_message_inbox_size_maximum();
+	app_message_open(inbox_size, OUTBOX_SIZE);
+	
+	//rows that fit in one message once every other key a chunk can carry is taken out:
+	//COMMAND, BYTES, LINE, ID, TRANSFER, SEQUENCE, PASS and TOTAL
+	int payload_size = inbox_size - dict_calc_buffer_size(8, sizeof(int32_t), 0, sizeof(int32_t), sizeof(int32_t),
+		sizeof(int32_t), sizeof(int32_t), sizeof(int32_t), sizeof(int32_t));
+	image_message_rows = payload_size / (144/8);
+	icon_message_rows = payload_size / (48/8);
+	if(image_message_rows > 144)
+		image_message_rows = 144;
+	if(icon_message_rows > 48)
+		icon_message_rows = 48;
+	
+	//startup sync
+	sniff_changed_at = now_ms();
+	keep_radio_awake();
+	
+	//handshake first, then what is already here so the phone only sends new or changed cards
+	hello_pending = 1;
+	for(int i=0; i<CACHE_SIZE; i++)
+	{
+		if(slot_loaded[i] == ALL_LOADED)
+		{
+			cached_pending |= 1 << i;
+			if(slot_icons[i] >= 0 && !icon_store_ready[slot_icons[i]])
+				send_icon_status(i, icon_store_hashes[slot_icons[i]], 1);
+		}
+	}
+	send_next_message();
 }
 
 void deinit()
@@ -887,4 +3063,5 @@ int main(void)
 	init();
 	app_event_loop();
 	deinit();
+	return 0;
 }